@@ -0,0 +1,451 @@
+/**
+ * @brief 盤面ファイルを読み込んで並列に解くコマンドラインのソルバ
+ * @note 使い方: batch_solver <盤面ファイル> [--size N | --catalog FILE] [--dim 2|3] [--mirror] [--mode count|solve|feasible|family|subsets|generate|rate] [--threads T] [--node-limit N] [--time-limit MS] [--pieces K] [--copies C] [--count N] [--holes H] [--max-clues K] [--seed S]
+ * @note 盤面ファイルは.がEMPTY, #がHOLEの行からなり, 盤面同士は空行で区切る
+ * @note --dim 3ではピースをポリキューブとし, 盤面の-だけの行でz方向の層を区切る(鏡像の向きは--mirrorを付けた場合のみ使う)
+ * @note --catalogではピースの形を同じ形式(#がピースのマス)のファイルから読む, マス数の異なる形を混ぜてよく, 同じ形が複数あれば個数になる
+ * @note 各盤面の結果を1行のJSONとして標準出力に書く(終わった順, idは盤面の番号)
+ * @note subsetsでは盤面をちょうど埋めるピースの部分集合(--piecesで個数を指定)を見つかった順に1行ずつ書く
+ * @note familyでは外接長方形が共通の盤面をBoardFamilyでまとめて数え, 最後に全体のスループットを1行のJSONで書く
+ * @note rateでは--node-limitまでの探索の記録から難易度を評価し, 深さごとの平均の分岐数とともに書く
+ * @note generateでは各盤面をひな形に唯一解の問題を--count個ずつ作り, 問題ごとに1行(ヒントのピースは英字)と最後に生成速度を1行書く
+*/
+
+#define POLYOMINO_HEADLESS
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+#include <atomic>
+#include "header/omino_packing.h"
+#include "header/board_family.h"
+#include "header/puzzle_generator.h"
+#include "header/difficulty.h"
+#include "header/stopwatch.h"
+
+using namespace PolyominoPuzzle;
+
+/**
+ * @brief 実行時の設定
+*/
+struct BatchOption{
+    std::string path;                   // 盤面ファイル
+    int omino_size = 5;                 // ピースのマス数
+    std::string catalog_path;           // ピースの形のファイル(空ならomino_sizeの全てのポリオミノ)
+    std::string mode = "count";         // count: 解の個数, solve: 解の列挙, feasible: 解の有無, family: 盤面の族ごとに解の個数, subsets: 埋められるピースの部分集合, generate: 唯一解の問題の生成, rate: 難易度の評価
+    int thread_num = 0;                 // スレッド数(0ならハードウェアのスレッド数)
+    long long int node_limit = -1;      // feasible, generate, rateの探索ノード数の上限
+    double time_limit = -1;             // feasibleの探索時間の上限[ms]
+    int piece_num = -1;                 // subsetsで使うピースの数(負なら任意)
+    int copies = 1;                     // 各ピースの個数(同じ形のピースは区別しない)
+    int dimension = 2;                  // 2: ポリオミノ, 3: ポリキューブ
+    bool mirror = false;                // ポリキューブで鏡像の向きも使うか(ポリオミノは常に使う)
+    int puzzle_num = 10;                // generateで盤面ごとに作る問題の数
+    int hole_num = 0;                   // generateで問題ごとにランダムに加えるHOLEの数
+    int max_clues = -1;                 // generateで置くヒントのピースの数の上限(負なら無制限)
+    unsigned long long seed = 1;        // generateの乱数の種
+};
+
+/**
+ * @brief 盤面ファイルから盤面を1つずつ読み出す(複数のスレッドから呼ぶ)
+*/
+struct BoardReader{
+    std::ifstream ifs;
+    std::mutex mtx;
+    int next_id = 0;
+
+    BoardReader(std::string const & path) : ifs(path){}
+
+    /**
+     * @brief 次の盤面を読む
+     * @param[out] id 盤面の番号
+     * @param[out] lines 盤面の各行
+     * @return 盤面がなければfalse
+    */
+    bool next(int & id, std::vector<std::string> & lines){
+        std::lock_guard<std::mutex> lock(mtx);
+        lines.clear();
+        std::string line;
+        while(std::getline(ifs, line)){
+            if(!line.empty() && line.back() == '\r') line.pop_back();
+            if(line.empty()){
+                if(lines.empty()) continue;
+                break;
+            }
+            lines.push_back(line);
+        }
+        if(lines.empty()) return false;
+        id = next_id++;
+        return true;
+    }
+};
+
+/**
+ * @brief z方向の層の区切りの行か(-のみ)
+*/
+bool is_layer_separator(std::string const & line){
+    return line.find_first_not_of('-') == std::string::npos;
+}
+
+/**
+ * @brief 盤面の文字列が正しい形式か(全ての行が同じ長さで.と#のみ, 三次元では各層の行数が同じ)
+*/
+bool valid_board(std::vector<std::string> const & lines, int const dimension, std::string & error){
+    std::string const & first = lines.front();
+    int rows = 0, layer_rows = -1;
+    for(int k=0; k<=(int)lines.size(); ++k){
+        if(k == (int)lines.size() || is_layer_separator(lines[k])){
+            if(k < (int)lines.size() && dimension != 3){
+                error = "layer separator in a 2D board (use --dim 3)";
+                return false;
+            }
+            if(rows == 0 || (layer_rows >= 0 && rows != layer_rows)){
+                error = "layers have different heights";
+                return false;
+            }
+            layer_rows = rows;
+            rows = 0;
+            continue;
+        }
+        ++rows;
+        if(lines[k].size() != first.size()){
+            error = "rows have different lengths";
+            return false;
+        }
+        if(lines[k].find_first_not_of(".#") != std::string::npos){
+            error = "unexpected character (only '.' and '#' are allowed)";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 盤面の文字列から盤面を作る, 層の区切りがあれば三次元の盤面にする
+*/
+Board make_board(std::vector<std::string> const & lines){
+    std::vector<std::vector<std::string>> layer(1);
+    for(auto const & l : lines){
+        if(is_layer_separator(l)) layer.emplace_back();
+        else layer.back().push_back(l);
+    }
+    if(layer.size() == 1) return Board(lines);
+    Board res = Board::box(layer[0][0].size(), layer[0].size(), layer.size());
+    for(int z=0; z<(int)layer.size(); ++z){
+        for(int y=0; y<(int)layer[z].size(); ++y){
+            for(int x=0; x<(int)layer[z][y].size(); ++x){
+                if(layer[z][y][x] == '#') res[Coord{x, y, z}] = HOLE;
+            }
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief 難易度の評価結果をJSONの項目として書く
+*/
+template <typename Rating>
+void write_rating(std::ostream & out, Rating const & r){
+    out << ",\"score\":" << r.score << ",\"guess_bits\":" << r.guess_bits << ",\"forced_ratio\":" << r.forced_ratio;
+    out << ",\"dead_end_depth\":" << r.dead_end_depth << ",\"dead_ends\":" << r.dead_end << ",\"solutions\":" << r.solution;
+    out << ",\"complete\":" << (r.complete ? "true" : "false") << ",\"branching\":[";
+    for(int d=0; d<(int)r.profile.node.size(); ++d){
+        long long int const expanded = r.profile.node[d] - r.profile.dead_end[d];
+        out << (d ? "," : "") << (expanded > 0 ? (double)r.profile.live[d] / expanded : 0.0);
+    }
+    out << "]";
+}
+
+/**
+ * @brief 盤面を読み出しては解くワーカー, PackingPuzzleはスレッドごとに1つを使い回す(キャッシュも引き継ぐ)
+*/
+template <typename Omino>
+void solve_worker(BatchOption const & opt, BoardReader & reader, std::mutex & out_mtx, std::shared_ptr<PieceCatalog<Omino> const> const & catalog, std::vector<int> const & inventory){
+    PackingPuzzle<Omino> puzzle(0, 0, catalog);
+    int id;
+    std::vector<std::string> lines;
+    while(reader.next(id, lines)){
+        std::ostringstream out;
+        out << "{\"id\":" << id;
+        std::string error;
+        if(!valid_board(lines, opt.dimension, error)){
+            out << ",\"error\":\"" << error << "\"}";
+        }else{
+            puzzle.board = make_board(lines);
+            puzzle.set_inventory(inventory);
+            puzzle.ans.clear();
+            puzzle.iterate_num = puzzle.cache_hit = puzzle.cache_miss = puzzle.coverage_cut = 0;
+
+            Stopwatch sw;
+            sw.start();
+            out << ",\"width\":" << puzzle.board.w_size << ",\"height\":" << puzzle.board.h_size;
+            if(puzzle.board.d_size != 1) out << ",\"depth\":" << puzzle.board.d_size;
+            if(opt.mode == "solve"){
+                puzzle.solve();
+                out << ",\"count\":" << puzzle.ans.size();
+                puzzle.ans.clear();
+            }else if(opt.mode == "subsets"){
+                long long int const num = puzzle.list_subsets(opt.piece_num, [&](unsigned long long const mask){
+                    std::lock_guard<std::mutex> lock(out_mtx);
+                    std::cout << "{\"id\":" << id << ",\"subset\":[";
+                    for(int i=0, first=1; i<(int)puzzle.base.size(); ++i){
+                        for(int k=0; k<puzzle.piece_count(mask, i); ++k){
+                            std::cout << (first ? "" : ",") << i;
+                            first = 0;
+                        }
+                    }
+                    std::cout << "]}" << std::endl;
+                    return true;
+                });
+                out << ",\"subsets\":" << num;
+            }else if(opt.mode == "feasible"){
+                Feasibility const res = puzzle.feasible(opt.node_limit, opt.time_limit);
+                out << ",\"feasible\":\"" << (res == Feasibility::yes ? "yes" : res == Feasibility::no ? "no" : "unknown") << "\"";
+            }else if(opt.mode == "rate"){
+                DifficultyRater<Omino> rater;
+                if(opt.node_limit > 0) rater.node_limit = opt.node_limit;
+                write_rating(out, rater.rate(puzzle));
+            }else{
+                out << ",\"count\":" << puzzle.count();
+            }
+            out << ",\"time_ms\":" << sw.stop();
+            out << ",\"nodes\":" << puzzle.iterate_num;
+            out << ",\"cache_hit\":" << puzzle.cache_hit << ",\"cache_miss\":" << puzzle.cache_miss;
+            out << ",\"coverage_cut\":" << puzzle.coverage_cut << "}";
+        }
+
+        std::lock_guard<std::mutex> lock(out_mtx);
+        std::cout << out.str() << std::endl;
+    }
+}
+
+/**
+ * @brief 全ての盤面を読み, 外接長方形が共通の盤面の族ごとにまとめて数える(族ごとに並列)
+*/
+template <typename Omino>
+void run_family(int const thread_num, BoardReader & reader, std::shared_ptr<PieceCatalog<Omino> const> const & catalog, std::vector<int> const & inventory){
+    std::vector<BoardFamily<Omino>> family;
+    std::vector<std::vector<int>> family_id;    // [族][族の中の番号] -> 盤面の番号
+    int id;
+    std::vector<std::string> lines;
+    while(reader.next(id, lines)){
+        std::string error;
+        if(!valid_board(lines, 2, error)){
+            std::cout << "{\"id\":" << id << ",\"error\":\"" << error << "\"}" << std::endl;
+            continue;
+        }
+        Board const b(lines);
+        int f = 0;
+        while(f < (int)family.size() && !family[f].add(b)) ++f;
+        if(f == (int)family.size()){
+            family.emplace_back(catalog);
+            family.back().inventory = inventory;
+            family_id.emplace_back();
+            family.back().add(b);
+        }
+        family_id[f].push_back(id);
+    }
+
+    std::mutex out_mtx;
+    std::atomic<int> next{0};
+    auto worker = [&](){
+        for(int f = next++; f < (int)family.size(); f = next++){
+            family[f].count();
+            std::lock_guard<std::mutex> lock(out_mtx);
+            for(int i=0; i<(int)family[f].board.size(); ++i){
+                auto const & r = family[f].result[i];
+                std::cout << "{\"id\":" << family_id[f][i] << ",\"family\":" << f;
+                std::cout << ",\"width\":" << family[f].w_size << ",\"height\":" << family[f].h_size << ",\"transposed\":" << (r.transposed ? "true" : "false");
+                std::cout << ",\"count\":" << r.count << ",\"same_as\":" << (r.same_as < 0 ? -1 : family_id[f][r.same_as]);
+                std::cout << ",\"time_ms\":" << r.time_ms << ",\"nodes\":" << r.nodes;
+                std::cout << ",\"cache_hit\":" << r.cache_hit << ",\"cache_miss\":" << r.cache_miss << "}" << std::endl;
+            }
+        }
+    };
+    Stopwatch sw;
+    sw.start();
+    std::vector<std::thread> threads;
+    for(int t=1; t<std::min(thread_num, (int)family.size()); ++t) threads.emplace_back(worker);
+    worker();
+    for(auto & th : threads) th.join();
+    double const ms = sw.stop();
+
+    int board_num = 0;
+    long long int node_num = 0;
+    for(auto const & f : family){
+        board_num += (int)f.board.size();
+        node_num += f.total_nodes;
+    }
+    std::cout << "{\"boards\":" << board_num << ",\"families\":" << family.size() << ",\"time_ms\":" << ms;
+    std::cout << ",\"boards_per_sec\":" << (ms > 0 ? board_num * 1000.0 / ms : 0) << ",\"nodes_per_sec\":" << (ms > 0 ? node_num * 1000.0 / ms : 0) << "}" << std::endl;
+}
+
+/**
+ * @brief 盤面を1行ずつの文字列にする(.がEMPTY, #がHOLE, ピースは番号順の英字)
+*/
+void write_rows(std::ostream & out, Board const & b){
+    static std::string const letter = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    out << "[";
+    for(int y=0; y<(int)b.h_size; ++y){
+        out << (y ? ",\"" : "\"");
+        for(int x=0; x<(int)b.w_size; ++x){
+            int const v = b[x][y];
+            out << (v == EMPTY ? '.' : v == HOLE ? '#' : v < (int)letter.size() ? letter[v] : '?');
+        }
+        out << "\"";
+    }
+    out << "]";
+}
+
+/**
+ * @brief 各盤面をひな形に唯一解の問題を作る(生成器の中で並列)
+*/
+template <typename Omino>
+void run_generate(BatchOption const & opt, int const thread_num, BoardReader & reader, std::shared_ptr<PieceCatalog<Omino> const> const & catalog, std::vector<int> const & inventory){
+    int id, total = 0;
+    long long int candidates = 0;
+    std::vector<std::string> lines;
+    Stopwatch sw;
+    sw.start();
+    while(reader.next(id, lines)){
+        std::string error;
+        if(!valid_board(lines, 2, error)){
+            std::cout << "{\"id\":" << id << ",\"error\":\"" << error << "\"}" << std::endl;
+            continue;
+        }
+        UniquePuzzleGenerator<Omino> gen(Board(lines), catalog);
+        gen.inventory = inventory;
+        gen.hole_num = opt.hole_num;
+        gen.max_clues = opt.max_clues;
+        gen.thread_num = thread_num;
+        gen.seed = opt.seed + id;
+        if(opt.node_limit > 0) gen.node_limit = opt.node_limit;
+        PackingPuzzle<Omino> rated(0, 0, catalog);
+        DifficultyRater<Omino> rater;
+        total += gen.generate(opt.puzzle_num, [&](auto const & p){
+            rated.board = p.board;
+            rated.set_inventory(p.unuse);
+            std::cout << "{\"id\":" << id << ",\"clues\":" << p.clue_num << ",\"score\":" << rater.rate(rated).score << ",\"puzzle\":";
+            write_rows(std::cout, p.board);
+            std::cout << ",\"solution\":";
+            write_rows(std::cout, p.solution);
+            std::cout << "}" << std::endl;
+            return true;
+        });
+        candidates += gen.candidate_num;
+    }
+    double const ms = sw.stop();
+    std::cout << "{\"puzzles\":" << total << ",\"candidates\":" << candidates << ",\"time_ms\":" << ms;
+    std::cout << ",\"puzzles_per_min\":" << (ms > 0 ? total * 60000.0 / ms : 0) << "}" << std::endl;
+}
+
+/**
+ * @brief ワーカーをスレッド数だけ動かす
+ * @param[in] catalog ピースの形(全てのスレッドで共有)
+ * @param[in] inventory [ピース] -> 1組あたりの個数(空なら1個ずつ), opt.copies倍して使う
+*/
+template <typename Omino>
+void run(BatchOption const & opt, BoardReader & reader, std::shared_ptr<PieceCatalog<Omino> const> catalog, std::vector<int> inventory = {}){
+    if(opt.mirror && !catalog->mirror) catalog = std::make_shared<PieceCatalog<Omino> const>(catalog->base, true);
+    if(inventory.empty()) inventory.assign(catalog->base.size(), 1);
+    for(auto & n : inventory) n *= opt.copies;
+    std::mutex out_mtx;
+    int const num = opt.thread_num > 0 ? opt.thread_num : std::max(1, (int)std::thread::hardware_concurrency());
+    if(opt.mode == "family"){
+        if constexpr (Omino::dimension == 2) run_family<Omino>(num, reader, catalog, inventory);
+        return;
+    }
+    if(opt.mode == "generate"){
+        if constexpr (Omino::dimension == 2) run_generate<Omino>(opt, num, reader, catalog, inventory);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for(int t=0; t<num; ++t) threads.emplace_back(solve_worker<Omino>, std::cref(opt), std::ref(reader), std::ref(out_mtx), std::cref(catalog), std::cref(inventory));
+    for(auto & th : threads) th.join();
+}
+
+int main(int argc, char ** argv){
+    BatchOption opt;
+    for(int i=1; i<argc; ++i){
+        std::string const arg = argv[i];
+        bool const has_value = (i + 1 < argc);
+        if(arg == "--size" && has_value) opt.omino_size = std::atoi(argv[++i]);
+        else if(arg == "--catalog" && has_value) opt.catalog_path = argv[++i];
+        else if(arg == "--mode" && has_value) opt.mode = argv[++i];
+        else if(arg == "--threads" && has_value) opt.thread_num = std::atoi(argv[++i]);
+        else if(arg == "--node-limit" && has_value) opt.node_limit = std::atoll(argv[++i]);
+        else if(arg == "--time-limit" && has_value) opt.time_limit = std::atof(argv[++i]);
+        else if(arg == "--pieces" && has_value) opt.piece_num = std::atoi(argv[++i]);
+        else if(arg == "--copies" && has_value) opt.copies = std::atoi(argv[++i]);
+        else if(arg == "--dim" && has_value) opt.dimension = std::atoi(argv[++i]);
+        else if(arg == "--count" && has_value) opt.puzzle_num = std::atoi(argv[++i]);
+        else if(arg == "--holes" && has_value) opt.hole_num = std::atoi(argv[++i]);
+        else if(arg == "--max-clues" && has_value) opt.max_clues = std::atoi(argv[++i]);
+        else if(arg == "--seed" && has_value) opt.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if(arg == "--mirror") opt.mirror = true;
+        else if(opt.path.empty() && arg.rfind("--", 0) != 0) opt.path = arg;
+        else{
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if(opt.path.empty() || (opt.mode != "count" && opt.mode != "solve" && opt.mode != "feasible" && opt.mode != "family" && opt.mode != "subsets" && opt.mode != "generate" && opt.mode != "rate") || (opt.dimension != 2 && opt.dimension != 3)){
+        std::cerr << "usage: " << argv[0] << " <board file> [--size N | --catalog FILE] [--dim 2|3] [--mirror] [--mode count|solve|feasible|family|subsets|generate|rate] [--threads T] [--node-limit N] [--time-limit MS] [--pieces K] [--copies C] [--count N] [--holes H] [--max-clues K] [--seed S]" << std::endl;
+        return 1;
+    }
+    if(opt.dimension == 3 && (opt.mode == "family" || opt.mode == "generate")){
+        std::cerr << opt.mode << " mode supports only 2D boards" << std::endl;
+        return 1;
+    }
+
+    BoardReader reader(opt.path);
+    if(!reader.ifs){
+        std::cerr << "cannot open " << opt.path << std::endl;
+        return 1;
+    }
+
+    if(!opt.catalog_path.empty()){
+        std::vector<int> inventory;
+        std::string error;
+        if(opt.dimension == 3){
+            auto const catalog = PieceCatalog<MixedCube>::load(opt.catalog_path, inventory, error);
+            if(catalog) run<MixedCube>(opt, reader, catalog, inventory);
+        }else{
+            auto const catalog = PieceCatalog<MixedOmino>::load(opt.catalog_path, inventory, error);
+            if(catalog) run<MixedOmino>(opt, reader, catalog, inventory);
+        }
+        if(!error.empty()){
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if(opt.dimension == 3){
+        switch(opt.omino_size){
+        case 3: run<Tricube>(opt, reader, PieceCatalog<Tricube>::standard()); break;
+        case 4: run<Tetracube>(opt, reader, PieceCatalog<Tetracube>::standard()); break;
+        case 5: run<Pentacube>(opt, reader, PieceCatalog<Pentacube>::standard()); break;
+        default:
+            std::cerr << "unsupported piece size: " << opt.omino_size << " (3-5 for polycubes)" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    switch(opt.omino_size){
+    case 3: run<Tromino>(opt, reader, PieceCatalog<Tromino>::standard()); break;
+    case 4: run<Tetromino>(opt, reader, PieceCatalog<Tetromino>::standard()); break;
+    case 5: run<Pentomino>(opt, reader, PieceCatalog<Pentomino>::standard()); break;
+    case 6: run<Hexomino>(opt, reader, PieceCatalog<Hexomino>::standard()); break;
+    default:
+        std::cerr << "unsupported piece size: " << opt.omino_size << " (3-6)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * @brief 外接長方形が共通の盤面の族をまとめて数える
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+#include "polyomino.h"
+#include "piece_catalog.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 穴の位置だけが異なる盤面など, 外接長方形が共通の盤面の族の解の個数を数える
+ * @note 全ての盤面を1つのPackingPuzzleで順に数えるので, 配置のビット表現(span)は最初の盤面で一度だけ作られる
+ * @note 残りの空きマスの正規形をキーとするcount_cache, tiling_cache, fillable_cacheも盤面をまたいで引き継ぐため,
+ *       盤面同士で一致する部分の探索結果は2枚目以降で再利用される
+ * @note 縦横が入れ替わった盤面は転置して族に加える(ピースの回転・鏡像を全て使うので解の個数は変わらない)
+ * @note 列優先で探索するので, 外接長方形は横長(w_size >= h_size)に揃える
+ * @note 同じ理由で, 族の中の盤面を回転・鏡像したものと一致する盤面は数えずにその結果を使う
+*/
+template <typename Omino>
+struct BoardFamily{
+    /**
+     * @brief 盤面ごとの結果
+    */
+    struct Result{
+        long long int count = -1;               // 解の個数(未計算なら-1)
+        double time_ms{};                       // 数えるのにかかった時間[ms]
+        long long int nodes{};                  // 探索したノード数
+        long long int cache_hit{}, cache_miss{};
+        bool transposed{};                      // 転置して族に加えたか
+        int same_as = -1;                       // 回転・鏡像で一致し, 結果を流用した盤面の番号(なければ-1)
+    };
+
+    std::vector<Board> board;                   // 族の盤面(全て w_size * h_size)
+    std::vector<Result> result;                 // [盤面] -> 結果
+    size_t w_size{}, h_size{};                  // 共通の外接長方形
+    int cache_area_limit{};                     // count_cacheに記録する残りの空きマスの最大数(0ならPackingPuzzleの既定値)
+    bool flag_symmetry = true;                  // 回転・鏡像で一致する盤面の結果を流用するか
+    std::vector<int> inventory;                 // 各ピースの個数(空なら1個ずつ)
+    double total_ms{};                          // 全ての盤面を数えるのにかかった時間[ms]
+    long long int total_nodes{};                // 全ての盤面で探索したノード数
+
+    /**
+     * @note 族の盤面は部分的に一致することが多いので, count_cacheに記録する領域はPackingPuzzleの既定値より大きくする
+    */
+    BoardFamily(std::shared_ptr<PieceCatalog<Omino> const> _catalog = PieceCatalog<Omino>::standard()) : puzzle(0, 0, std::move(_catalog)){
+        cache_area_limit = 6 * puzzle.catalog->max_size;
+    }
+
+    /**
+     * @brief 盤面を族に加える
+     * @return 外接長方形が族と異なり加えられなければfalse
+    */
+    bool add(Board const & b){
+        bool flip = false;
+        if(board.empty()){
+            flip = (b.h_size > b.w_size);
+            w_size = std::max(b.w_size, b.h_size);
+            h_size = std::min(b.w_size, b.h_size);
+        }else if(b.w_size != w_size || b.h_size != h_size){
+            if(b.h_size != w_size || b.w_size != h_size) return false;
+            flip = true;
+        }
+        board.push_back(flip ? transposed(b) : b);
+        result.push_back({});
+        result.back().transposed = flip;
+        return true;
+    }
+
+    /**
+     * @brief 族の全ての盤面の解の個数を順に数える
+     * @note 盤面のEMPTY以外(HOLEや置かれたピース)は埋めなくてよいマスとして扱い, inventoryのピースを全て使う
+    */
+    void count(){
+        if(cache_area_limit > 0) puzzle.small_area_limit = cache_area_limit;
+        total_ms = 0;
+        total_nodes = 0;
+        std::map<std::vector<std::vector<int>>, int> seen;     // 回転・鏡像の正規形 -> 最初に数えた盤面
+        for(int i=0; i<(int)board.size(); ++i){
+            Result & r = result[i];
+            r.same_as = -1;
+            if(flag_symmetry){
+                auto it = seen.emplace(canonical(board[i]), i).first;
+                if(it->second != i){
+                    r.same_as = it->second;
+                    r.count = result[r.same_as].count;
+                    r.time_ms = 0;
+                    r.nodes = r.cache_hit = r.cache_miss = 0;
+                    continue;
+                }
+            }
+            puzzle.board = board[i];
+            if(inventory.empty()) puzzle.unuse.assign(puzzle.base.size(), 1);
+            else puzzle.set_inventory(inventory);
+            puzzle.iterate_num = puzzle.cache_hit = puzzle.cache_miss = 0;
+            auto const start = std::chrono::steady_clock::now();
+            r.count = puzzle.count();
+            r.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            r.nodes = puzzle.iterate_num;
+            r.cache_hit = puzzle.cache_hit;
+            r.cache_miss = puzzle.cache_miss;
+            total_ms += r.time_ms;
+            total_nodes += r.nodes;
+        }
+    }
+
+    /**
+     * @brief 1秒あたりに数えた盤面の数
+    */
+    double boards_per_sec() const {
+        return total_ms > 0 ? board.size() * 1000.0 / total_ms : 0;
+    }
+
+    /**
+     * @brief 1秒あたりに探索したノード数
+    */
+    double nodes_per_sec() const {
+        return total_ms > 0 ? total_nodes * 1000.0 / total_ms : 0;
+    }
+
+    /**
+     * @brief 盤面の縦横を入れ替える
+    */
+    static Board transposed(Board const & b){
+        Board res(b.h_size, b.w_size);
+        for(int x=0; x<(int)b.w_size; ++x){
+            for(int y=0; y<(int)b.h_size; ++y) res[y][x] = b[x][y];
+        }
+        return res;
+    }
+
+private:
+    /**
+     * @brief 盤面の回転・鏡像のうち最小のもの(正方形なら8通り, それ以外は外接長方形を保つ4通り)
+    */
+    static std::vector<std::vector<int>> canonical(Board const & b){
+        Board cur = b;
+        std::vector<std::vector<int>> res = b.board;
+        for(int k=0; k<(b.w_size == b.h_size ? 8 : 4); ++k){
+            // 正方形は転置と左右反転を交互に, それ以外は左右反転と上下反転を交互に行うと全ての対称な形を巡る
+            Board next = cur;
+            bool const flip_x = (b.w_size == b.h_size ? k % 2 == 1 : k % 2 == 0);
+            if(b.w_size == b.h_size && !flip_x) next = transposed(cur);
+            for(int x=0; x<(int)cur.w_size; ++x){
+                for(int y=0; y<(int)cur.h_size; ++y){
+                    if(flip_x) next[x][y] = cur[cur.w_size - 1 - x][y];
+                    else if(b.w_size != b.h_size) next[x][y] = cur[x][cur.h_size - 1 - y];
+                }
+            }
+            cur = std::move(next);
+            res = std::min(res, cur.board);
+        }
+        return res;
+    }
+
+    PackingPuzzle<Omino> puzzle;                // 全ての盤面で使い回す(span・キャッシュを引き継ぐ)
+};
+
+} // namespace PolyominoPuzzle
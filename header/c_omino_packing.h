@@ -5,9 +5,13 @@
 #pragma once
 
 #include <utility>
-#include <stack>
 #include "polyomino.h"
 #include "omino_packing.h"
+#include "heatmap.h"
+#include "speculation.h"
+#include "zobrist.h"
+#include "placement_game.h"
+#include "lru_cache.h"
 #include "console_printer.h"
 #include "console_option.h"
 // #include "console_printer.h"
@@ -177,21 +181,52 @@ private:
 */
 template <typename DOmino>
 struct PackingPuzzleGame{
+    /**
+     * @brief 配置の記録(undo/redo用)
+    */
+    struct PutRecord{
+        int piece;                      // ピース番号
+        int pattern;                    // 回転・鏡像のパターン番号
+        Coord pos;                      // 配置場所(aabbの左上)
+    };
+
+    /**
+     * @brief 盤面の状態ごとに記録する解の個数
+    */
+    struct RemainEntry{
+        long long int remain;           // 解の個数(数えていなければ-1)
+        Feasibility solvable;           // 解が作れるか
+    };
+
     PackingPuzzle<DOmino> puzzle;
     ItemsOption<DOmino> omino_option;
-    std::stack<int> pre_put;            // 前回配置したピースid, 現在ピースをいくつ使用しているか
+    std::vector<PutRecord> pre_put;     // 配置したピースの記録, 現在ピースをいくつ使用しているか
+    std::vector<PutRecord> redo_put;    // undoで取り除いたピースの記録
+    ZobristHash zobrist;                // 配置済みのピースの集合のハッシュ
+    LruCache<unsigned long long, RemainEntry> remain_cache{4096};   // 盤面の状態のハッシュ -> 解の個数
     Coord put_pos;                      // ピースの配置位置
     int selection_piece{}, piece_pattern{};
     bool flag_putting{};                // ピース配置中を示すフラグ
     bool flag_complete{};               // パズルを完成させたかどうか
     int board_draw_x, board_draw_y;     // ボードの描画位置
-    int remain = -1;                    // 現状から作れる解の個数
+    long long int remain = -1;          // 現状から作れる解の個数
     int remain_threshold = 12;          // 残り何ピースになってから解の個数更新を開始するか
-
-    PackingPuzzleGame(std::vector<std::string> const & b, int const per_page = 5) : puzzle(b), omino_option(puzzle.base, per_page){
+    Feasibility solvable = Feasibility::unknown;    // 現状から解が作れるか
+    long long int feasible_node_limit = 1000000;    // 解が作れるかの判定で探索するノード数の上限
+    double feasible_time_limit = 200;               // 解が作れるかの判定の時間の上限[ms]
+    PlacementHeatmap<DOmino> heatmap;               // 選択中のピースの各配置の解の個数
+    bool flag_heatmap = true;                       // 配置ごとの解の個数を盤面に重ねて表示するか
+    SpeculativeCounter<DOmino> speculation;         // 配置中の場所と周囲の解の個数を裏で数える
+    bool flag_speculate = true;                     // 配置中に解の個数を先に数えておくか
+    PlacementGameAI<DOmino> ai{puzzle.catalog};     // 対戦相手の思考ルーチン
+    bool flag_versus{};                             // コンピュータと交互に置き, 置けなくなった方が負けの対戦をするか
+    int winner = -1;                                // 対戦の勝者(0: プレイヤー, 1: コンピュータ, 負なら対戦中)
+
+    PackingPuzzleGame(std::vector<std::string> const & b, int const per_page = 5) : puzzle(b), omino_option(puzzle.base, per_page), speculation(puzzle){
         omino_option.set_pos(puzzle.board.h_size*2+1 + 2, 2);
         board_draw_x = (omino_option.item_size_x * per_page + omino_option.margin * (per_page - 1)) / 2 - ((int)puzzle.board.w_size * 4 + 1) / 2;
         board_draw_y = 1;
+        zobrist.init(puzzle.pattern, puzzle.board.w_size, puzzle.board.h_size);
 
         // 一旦解いて解の個数を計算
         update_remain();
@@ -205,7 +240,9 @@ struct PackingPuzzleGame{
         switch(key){
         case 'q': exit(0); break;
         case 'p': reset(); break;
-        case 'u': undo(); break;
+        case 'u': undo(); if(flag_versus) undo(); break;
+        case 'y': redo(); if(flag_versus) redo(); break;
+        case 'v': toggle_versus(); break;
         }
 
         int id = omino_option.choice_without_keyinput(key);
@@ -215,6 +252,8 @@ struct PackingPuzzleGame{
         put_pos = Coord(0, 0);
         piece_pattern = 0;
         flag_putting = true;
+        update_heatmap();
+        speculate();
     }
 
     /**
@@ -234,9 +273,10 @@ struct PackingPuzzleGame{
         }
         
         // ピース位置を更新
-        if(puzzle.board.in(puzzle.pattern[selection_piece][piece_pattern], put_pos.moved_by(dx, dy))){
+        if(puzzle.board.in(puzzle.kernel[selection_piece][piece_pattern], put_pos.moved_by(dx, dy))){
             put_pos.move_by(dx, dy);
         }
+        speculate();
     }
 
     /**
@@ -248,8 +288,7 @@ struct PackingPuzzleGame{
 
         // 回転/鏡像でボードをはみ出してしまう場合ははみ出さない位置までput_posを戻す
         // if(puzzle.board.in(puzzle.pattern[selection_piece][piece_pattern], put_pos)) return;
-        auto [_min, _max] = puzzle.pattern[selection_piece][piece_pattern].get_aabb();
-        Coord over = put_pos + _max - _min - Coord((int)puzzle.board.w_size - 1, (int)puzzle.board.h_size - 1);
+        Coord over = put_pos + puzzle.kernel[selection_piece][piece_pattern].extent - Coord((int)puzzle.board.w_size - 1, (int)puzzle.board.h_size - 1);
         if(over.x > 0) put_pos.x -= over.x;
         if(over.y > 0) put_pos.y -= over.y;
     }
@@ -258,39 +297,121 @@ struct PackingPuzzleGame{
      * @brief 選択中のピースを選択した位置に配置、置けるかどうかの判定含む
     */
     void put_piece(){
-        // 置けない場合終了
-        if(!puzzle.board.putable(puzzle.pattern[selection_piece][piece_pattern], put_pos)) return;
-
-        // boardの更新
-        puzzle.board.put_piece(puzzle.pattern[selection_piece][piece_pattern], put_pos, selection_piece);
-        // unuseのフラグなどを更新
-        puzzle.unuse[selection_piece] = false;
-        omino_option.set_selectability(selection_piece, false);
-        flag_putting = false;
+        // 置けない場合・対戦が終わった場合終了
+        auto const & ker = puzzle.kernel[selection_piece][piece_pattern];
+        if(!puzzle.board.putable(ker, put_pos) || winner >= 0) return;
 
-        // undo用に配置したピース記憶
-        pre_put.emplace(selection_piece);
-        if((int)pre_put.size() == (int)puzzle.base.size()){
-            flag_complete = true;
+        // 先に数えてあればその結果を使う
+        long long int pre_num = heatmap.valid(puzzle, selection_piece) ? heatmap.num(piece_pattern, put_pos) : -1;
+        if(pre_num < 0 && !speculation.lookup(puzzle.board, puzzle.unuse, {selection_piece, piece_pattern, put_pos}, pre_num)) pre_num = -1;
+
+        // boardの更新, 新しく置いたらredoはできない
+        apply_put({selection_piece, piece_pattern, put_pos});
+        redo_put.clear();
+        flag_putting = false;
+        // 対戦中はコンピュータが続けて置く
+        if(flag_versus){
+            computer_move();
+            return;
         }
 
         // 解の個数を更新
+        if(pre_num >= 0){
+            remain = pre_num;
+            solvable = (pre_num > 0 ? Feasibility::yes : Feasibility::no);
+            remain_cache.put(zobrist.value, {remain, solvable});
+        }else{
+            update_remain();
+        }
+    }
+
+    /**
+     * @brief 対戦モードを切り替える(盤面が64マス以下の場合のみ)
+    */
+    void toggle_versus(){
+        flag_versus = !flag_versus && ai.set_position(puzzle.board, puzzle.unuse);
+        winner = -1;
+    }
+
+    /**
+     * @brief コンピュータが1手置き, どちらかが置けなくなったら勝者を決める
+     * @note 思考時間はai.time_limitまで
+    */
+    void computer_move(){
+        ai.set_position(puzzle.board, puzzle.unuse);
+        auto const res = ai.think();
+        if(res.move.piece < 0){
+            winner = 0;
+        }else{
+            apply_put({res.move.piece, res.move.pattern, res.move.pos});
+            ai.set_position(puzzle.board, puzzle.unuse);
+            if(ai.legal_moves().empty()) winner = 1;
+        }
         update_remain();
     }
 
+    /**
+     * @brief 配置を盤面・使用状況・ハッシュに反映し, undo用に記録する
+    */
+    void apply_put(PutRecord const & rec){
+        puzzle.board.put_piece(puzzle.kernel[rec.piece][rec.pattern], rec.pos, rec.piece);
+        --puzzle.unuse[rec.piece];
+        omino_option.set_selectability(rec.piece, false);
+        zobrist.toggle(rec.piece, rec.pattern, rec.pos);
+        pre_put.push_back(rec);
+        flag_complete = ((int)pre_put.size() == (int)puzzle.base.size());
+    }
+
+    /**
+     * @brief 配置中の場所・その周囲・次の回転/鏡像の解の個数を裏で数えるよう依頼する
+     * @note 配置後に解の個数を更新する場合のみ(残りのピースが少ない場合)
+    */
+    void speculate(){
+        if(!flag_speculate || !flag_putting || solvable == Feasibility::no) return;
+        if((int)puzzle.base.size() - (int)pre_put.size() - 1 > remain_threshold) return;
+        if(heatmap.valid(puzzle, selection_piece)) return;
+        using Placement = typename SpeculativeCounter<DOmino>::Placement;
+        std::vector<Placement> list;
+        auto add = [&](int const pattern, Coord const pos){
+            if(puzzle.board.putable(puzzle.kernel[selection_piece][pattern], pos)) list.push_back({selection_piece, pattern, pos});
+        };
+        add(piece_pattern, put_pos);
+        Coord const near[4] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+        for(auto const & d : near) add(piece_pattern, put_pos + d);
+        add((piece_pattern + 1) % (int)puzzle.pattern[selection_piece].size(), put_pos);
+        speculation.request(puzzle.board, puzzle.unuse, list);
+    }
+
     /**
      * @brief 直前に配置したピースを除く
     */
     void undo(){
         if(pre_put.empty()) return;
-        int id = pre_put.top();
-        pre_put.pop();
+        PutRecord const rec = pre_put.back();
+        pre_put.pop_back();
+
+        // 記録した配置のマスだけEMPTYに戻す
+        puzzle.board.put_piece(puzzle.kernel[rec.piece][rec.pattern], rec.pos, EMPTY);
+        // unuseの個数を戻す
+        ++puzzle.unuse[rec.piece];
+        omino_option.set_selectability(rec.piece, true);
+        zobrist.toggle(rec.piece, rec.pattern, rec.pos);
+        redo_put.push_back(rec);
+        flag_complete = false;
+        winner = -1;
+
+        // 解の個数を更新
+        update_remain();
+    }
 
-        // ボード更新(愚直に探す)
-        puzzle.board.remove_piece(id);
-        // unuseのフラグを戻す
-        puzzle.unuse[id] = true;
-        omino_option.set_selectability(id, true);
+    /**
+     * @brief undoで取り除いたピースを置き直す
+    */
+    void redo(){
+        if(redo_put.empty()) return;
+        PutRecord const rec = redo_put.back();
+        redo_put.pop_back();
+        apply_put(rec);
 
         // 解の個数を更新
         update_remain();
@@ -305,21 +426,78 @@ struct PackingPuzzleGame{
             puzzle.unuse[i] = true;
             omino_option.set_selectability(i, true);
         }
+        pre_put.clear();
+        redo_put.clear();
+        zobrist.clear();
+        flag_complete = false;
+        winner = -1;
 
         // 解の個数を更新
         update_remain();
     }
 
     /**
-     * @brief 解の個数を更新する
-     * @note ポリオミノパズルを解くため計算が重い
+     * @brief 解が作れるかを更新する
+     * @note 最初の解で打ち切り, 上限を超えたら不明とする
+    */
+    void update_solvable(){
+        solvable = puzzle.feasible(feasible_node_limit, feasible_time_limit);
+    }
+
+    /**
+     * @brief 解が作れるか・解の個数を更新する
+     * @note ポリオミノパズルを解くため計算が重い, 解が作れない場合は数えない
+     * @note 一度調べた状態はremain_cacheから取り出す
     */
     void update_remain(){
+        if(RemainEntry const * e = remain_cache.find(zobrist.value)){
+            solvable = e->solvable;
+            if(e->remain >= 0) remain = e->remain;
+            return;
+        }
+        update_solvable();
+        long long int counted = -1;
+        if(solvable == Feasibility::no){
+            counted = 0;
+        }else if((int)puzzle.base.size() - (int)pre_put.size() <= remain_threshold){
+            counted = puzzle.count();
+            if(pre_put.empty()) counted /= 4;
+        }
+        if(counted >= 0) remain = counted;
+        remain_cache.put(zobrist.value, {counted, solvable});
+    }
+
+    /**
+     * @brief 選択中のピースの配置ごとの解の個数を更新する
+     * @note 盤面が変わらなければ前回の結果を使う, 解の個数の更新と同じく残りのピースが少ない場合のみ
+    */
+    void update_heatmap(){
+        if(!flag_heatmap || solvable == Feasibility::no) return;
         if((int)puzzle.base.size() - (int)pre_put.size() > remain_threshold) return;
-        puzzle.ans.clear();
-        puzzle.solve({0, 0}, (int)pre_put.size());
-        remain = (int)puzzle.ans.size();
-        if(pre_put.empty()) remain /= 4;
+        heatmap.update(puzzle, selection_piece);
+    }
+
+    /**
+     * @brief 配置ごとの解の個数をボードに重ねて描画する
+     * @note 選択中のパターンを各マスにaabbの左上を合わせて置いた場合の個数を, そのマスに表示する
+    */
+    void draw_heatmap(int const y, int const x) const {
+        if(!flag_heatmap || !flag_putting || !heatmap.valid(puzzle, selection_piece)) return;
+        long long int const max_num = std::max(1LL, heatmap.max_num());
+        for(auto const & e : heatmap.entry){
+            if(e.pattern != piece_pattern || e.num < 0) continue;
+            std::cout << MovCursor(y + e.pos.y * 2 + 1, x + e.pos.x * 4 + 1);
+            if(e.num == 0){
+                std::cout << C_Red;
+            }else{
+                int const v = (int)(255 * e.num / max_num);
+                std::cout << ConsoleColor(255 - v, 255, 255 - v);
+            }
+            if(e.num < 1000) std::cout << std::setw(3) << e.num;
+            else if(e.num < 100000) std::cout << std::setw(2) << e.num / 1000 << "k";
+            else std::cout << "+++";
+            std::cout << C_Clear;
+        }
     }
 
     /**
@@ -394,6 +572,7 @@ struct PackingPuzzleGame{
             else std::cout << "━━━┻";
         }
         std::cout << "━━━┛" << std::endl;
+        draw_heatmap(y, x);
     }
 
     /**
@@ -431,6 +610,27 @@ struct PackingPuzzleGame{
         draw_description(board_draw_y, _x + 10);
     }
 
+    /**
+     * @brief 解が作れるかの表示用の文字列
+    */
+    char const * solvable_text() const {
+        switch(solvable){
+        case Feasibility::yes: return "あり";
+        case Feasibility::no: return "なし";
+        default: return "不明";
+        }
+    }
+
+    /**
+     * @brief 対戦の状況の表示用の文字列
+    */
+    char const * versus_text() const {
+        if(!flag_versus) return "";
+        if(winner == 0) return "対戦: あなたの勝ち！！";
+        if(winner == 1) return "対戦: コンピュータの勝ち";
+        return "対戦: あなたの番";
+    }
+
     /**
      * @brief 右枠の描画
     */
@@ -441,15 +641,25 @@ struct PackingPuzzleGame{
             std::cout << MovCursor(y+2, x) << OutputClearLine(0) << "z    : 置く";
             std::cout << MovCursor(y+3, x) << OutputClearLine(0) << "x    : キャンセル";
             std::cout << MovCursor(y+4, x) << OutputClearLine(0);
-            std::cout << MovCursor(y+6, x) << OutputClearLine(0) << "ここから作れる解の個数: " << remain;
+            std::cout << MovCursor(y+5, x) << OutputClearLine(0);
+            std::cout << MovCursor(y+6, x) << OutputClearLine(0);
+            std::cout << MovCursor(y+7, x) << OutputClearLine(0) << "ここから作れる解の個数: " << remain;
+            std::cout << MovCursor(y+8, x) << OutputClearLine(0) << "解の有無: " << solvable_text();
+            std::cout << MovCursor(y+9, x) << OutputClearLine(0);
+            std::cout << MovCursor(y+10, x) << OutputClearLine(0) << versus_text();
         }else{
             std::cout << MovCursor(y  , x) << OutputClearLine(0) << "ad   : ピース選択";
             std::cout << MovCursor(y+1, x) << OutputClearLine(0) << "z    : ピースの決定";
             std::cout << MovCursor(y+2, x) << OutputClearLine(0) << "k    : 盤面のクリア";
             std::cout << MovCursor(y+3, x) << OutputClearLine(0) << "u    : アンドゥ";
-            std::cout << MovCursor(y+4, x) << OutputClearLine(0) << "q    : 終了";
-            std::cout << MovCursor(y+6, x) << OutputClearLine(0) << "ここから作れる解の個数: " << remain;
-            if(flag_complete) std::cout << MovCursor(y+8, x) << "完成！！";
+            std::cout << MovCursor(y+4, x) << OutputClearLine(0) << "y    : リドゥ";
+            std::cout << MovCursor(y+5, x) << OutputClearLine(0) << "q    : 終了";
+            std::cout << MovCursor(y+6, x) << OutputClearLine(0) << "v    : 対戦モード";
+            std::cout << MovCursor(y+7, x) << OutputClearLine(0) << "ここから作れる解の個数: " << remain;
+            std::cout << MovCursor(y+8, x) << OutputClearLine(0) << "解の有無: " << solvable_text();
+            std::cout << MovCursor(y+9, x) << OutputClearLine(0);
+            if(flag_complete) std::cout << "完成！！";
+            std::cout << MovCursor(y+10, x) << OutputClearLine(0) << versus_text();
         }
     }
 };
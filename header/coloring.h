@@ -0,0 +1,167 @@
+/**
+ * @brief 盤面の彩色による枝刈り
+*/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <climits>
+#include "polyomino.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 盤面の彩色, 各マスに0からcolor_num-1の色を割り当てる
+*/
+struct Coloring{
+    int color_num;                                  // 色数
+    std::function<int(Coord const &)> color;        // マスの色
+};
+
+/**
+ * @brief 候補の彩色(市松模様(三次元の盤面ではzも含む), 縦横の2色・3色の縞模様)
+ * @note ペントミノの長方形・穴あき8x8の盤面では, どれも枝刈りで減るノードより判定の負荷の方が大きい
+ * @note 盤面に合わせてColoringPruner::coloringsに必要なものだけを入れて使う
+*/
+inline std::vector<Coloring> candidate_colorings(){
+    return {
+        {2, [](Coord const & c){ return (c.x + c.y + c.z) & 1; }},
+        {2, [](Coord const & c){ return c.x & 1; }},
+        {2, [](Coord const & c){ return c.y & 1; }},
+        {3, [](Coord const & c){ return c.x % 3; }},
+        {3, [](Coord const & c){ return c.y % 3; }},
+    };
+}
+
+/**
+ * @brief 既定の彩色(なし)
+ * @note 彩色を使わなくても, 置ける場所のないピースが残っていれば枝刈りされる
+*/
+inline std::vector<Coloring> default_colorings(){
+    return {};
+}
+
+/**
+ * @brief 彩色による枝刈り
+ * @note 各彩色の各色(チャンネル)について, 残りのEMPTYの数が残りのピースの覆いうる数の範囲に収まるかを調べる
+ * @note ピースが覆う各色の数の範囲は, 盤面上の全ての配置可能な位置・回転/鏡像から事前に求める
+*/
+struct ColoringPruner{
+    std::vector<Coloring> colorings;
+    std::vector<int> cell_channel;              // [マス][彩色] -> チャンネル番号
+    std::vector<int> channel_empty;             // 各チャンネルのEMPTYの数
+    std::vector<std::vector<int>> piece_min;    // [ピース][チャンネル] -> 覆う数の最小
+    std::vector<std::vector<int>> piece_max;    // [ピース][チャンネル] -> 覆う数の最大
+    std::vector<char> placeable;                // [ピース] -> 盤面上に置ける場所があるか
+    std::vector<int> rest_min, rest_max;        // 未使用のピースについてのpiece_min, piece_maxの和
+    int unplaceable{};                          // 置ける場所がない未使用のピースの数
+    int channel_num{};
+    int h_size{}, d_size{};
+
+    ColoringPruner(std::vector<Coloring> const & _colorings = default_colorings()) : colorings(_colorings){}
+
+    /**
+     * @brief 盤面と未使用のピースから各値を計算する
+     * @param[in] board 盤面
+     * @param[in] pattern 各ピースの回転・鏡像のカーネル(PlacementKernel)
+     * @param[in] unuse 各ピースの残りの個数
+    */
+    template <typename Kernel>
+    void init(Board const & board, std::vector<std::vector<Kernel>> const & pattern, std::vector<int> const & unuse){
+        h_size = (int)board.h_size;
+        d_size = (int)board.d_size;
+        channel_num = 0;
+        std::vector<int> offset;
+        for(auto const & col : colorings){
+            offset.push_back(channel_num);
+            channel_num += col.color_num;
+        }
+
+        // 各マスのチャンネルとEMPTYの数
+        cell_channel.assign(board.cell_num() * colorings.size(), 0);
+        channel_empty.assign(channel_num, 0);
+        for(int k=0; k<board.cell_num(); ++k){
+            Coord const p = board.coord(k);
+            for(int c=0; c<(int)colorings.size(); ++c){
+                int ch = offset[c] + colorings[c].color(p);
+                cell_channel[k * colorings.size() + c] = ch;
+                if(board[p] == EMPTY) ++channel_empty[ch];
+            }
+        }
+
+        // 各ピースが覆う数の範囲
+        piece_min.assign(pattern.size(), std::vector<int>(channel_num, INT_MAX));
+        piece_max.assign(pattern.size(), std::vector<int>(channel_num, 0));
+        placeable.assign(pattern.size(), false);
+        std::vector<int> cnt(channel_num);
+        for(int i=0; i<(int)pattern.size(); ++i){
+            for(auto const & shape : pattern[i]){
+                for(int k=0; k<board.cell_num(); ++k){
+                    Coord const pos = board.coord(k);
+                    if(!board.putable(shape, pos)) continue;
+                    placeable[i] = true;
+                    std::fill(cnt.begin(), cnt.end(), 0);
+                    shape.for_each(pos, [&](Coord const & p){
+                        for(int c=0; c<(int)colorings.size(); ++c) ++cnt[channel(p, c)];
+                    });
+                    for(int ch=0; ch<channel_num; ++ch){
+                        piece_min[i][ch] = std::min(piece_min[i][ch], cnt[ch]);
+                        piece_max[i][ch] = std::max(piece_max[i][ch], cnt[ch]);
+                    }
+                }
+            }
+        }
+
+        rest_min.assign(channel_num, 0);
+        rest_max.assign(channel_num, 0);
+        unplaceable = 0;
+        for(int i=0; i<(int)pattern.size(); ++i){
+            use_piece(i, -unuse[i]);
+        }
+    }
+
+    /**
+     * @brief マスの彩色cでのチャンネル番号
+    */
+    inline int channel(Coord const & p, int const c) const {
+        return cell_channel[((p.x * d_size + p.z) * h_size + p.y) * colorings.size() + c];
+    }
+
+    /**
+     * @brief マスを埋める(delta = 1)/空ける(delta = -1)
+    */
+    inline void fill_cell(Coord const & p, int const delta = 1){
+        for(int c=0; c<(int)colorings.size(); ++c) channel_empty[channel(p, c)] -= delta;
+    }
+
+    /**
+     * @brief ピースをdelta個使用する(負なら未使用に戻す)
+    */
+    inline void use_piece(int const id, int const delta = 1){
+        if(!placeable[id]){
+            unplaceable -= delta;
+            return;
+        }
+        for(int ch=0; ch<channel_num; ++ch){
+            rest_min[ch] -= delta * piece_min[id][ch];
+            rest_max[ch] -= delta * piece_max[id][ch];
+        }
+    }
+
+    /**
+     * @brief 現在の状態が彩色の条件を満たすか
+     * @param[in] all_used 残りのピースを全て使う必要がある(下限を調べる)
+     * @param[in] exact EMPTYを全て埋める必要がある(上限を調べる)
+    */
+    bool feasible(bool const all_used, bool const exact) const {
+        if(all_used && unplaceable > 0) return false;
+        for(int ch=0; ch<channel_num; ++ch){
+            if(all_used && channel_empty[ch] < rest_min[ch]) return false;
+            if(exact && channel_empty[ch] > rest_max[ch]) return false;
+        }
+        return true;
+    }
+};
+
+} // namespace PolyominoPuzzle
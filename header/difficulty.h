@@ -0,0 +1,96 @@
+/**
+ * @brief 上限付きの探索の記録から問題の難易度を見積もる
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include "polyomino.h"
+#include "piece_catalog.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 難易度の評価器
+ * @note PackingPuzzle::profileで局面を辿り, 深さごとの分岐数・一手に決まる局面・行き止まりの深さを点数にまとめる
+ * @note 全ての解を数える必要はなく, ノード数の上限までの記録で評価する(上限に達した問題は少なくともその点数以上の難しさ)
+*/
+template <typename Omino>
+struct DifficultyRater{
+    /**
+     * @brief 評価結果
+    */
+    struct Rating{
+        double score{};                 // 難易度(大きいほど難しい)
+        double guess_bits{};            // 深さごとの平均の分岐数(枝刈りされない子の数)のlog2の和, 推測が必要な量
+        double forced_ratio{};          // 一手に決まる局面の割合
+        double dead_end_depth{};        // 行き止まりの深さの平均を最大の深さで割った値(深いほど気付きにくい)
+        long long int dead_end{};       // 行き止まりの数
+        long long int nodes{};          // 探索したノード数
+        long long int solution{};       // 見つかった解の数
+        bool complete{};                // ノード数の上限に達せずに全て探索したか
+        SearchProfile profile;          // 深さごとの記録
+    };
+
+    long long int node_limit = 1000000; // 1つの盤面で探索するノード数の上限(負なら無制限)
+    int thread_num = 0;                 // rate_allで使うスレッド数(0ならハードウェアのスレッド数)
+
+    /**
+     * @brief 現在の盤面と未使用のピースの難易度を評価する
+     * @note score = guess_bits * (1 - forced_ratio / 2) + dead_end_depth * log2(1 + dead_end)
+    */
+    Rating rate(PackingPuzzle<Omino> & puzzle) const {
+        Rating res;
+        res.profile = puzzle.profile(node_limit);
+        SearchProfile const & p = res.profile;
+        res.nodes = p.nodes;
+        res.solution = p.solution;
+        res.complete = p.complete;
+
+        long long int node = 0, forced = 0, depth_sum = 0;
+        int const depth_max = std::max(1, (int)p.node.size() - 1);
+        for(int d=0; d<(int)p.node.size(); ++d){
+            if(p.node[d] > p.dead_end[d]) res.guess_bits += std::log2(std::max(1.0, (double)p.live[d] / (p.node[d] - p.dead_end[d])));
+            node += p.node[d];
+            forced += p.forced[d];
+            res.dead_end += p.dead_end[d];
+            depth_sum += p.dead_end[d] * d;
+        }
+        if(node > 0) res.forced_ratio = (double)forced / node;
+        if(res.dead_end > 0) res.dead_end_depth = (double)depth_sum / res.dead_end / depth_max;
+        res.score = res.guess_bits * (1 - res.forced_ratio / 2) + res.dead_end_depth * std::log2(1.0 + res.dead_end);
+        return res;
+    }
+
+    /**
+     * @brief 複数の問題を並列に評価する
+     * @param[in] board 問題の盤面(EMPTY以外は埋めなくてよいマス)
+     * @param[in] unuse [問題] -> 各ピースの残りの個数(空なら全ての問題でピースを1個ずつ)
+     * @note 各スレッドは自分のPackingPuzzleを使い回す
+    */
+    std::vector<Rating> rate_all(std::vector<Board> const & board, std::vector<std::vector<int>> const & unuse = {}, std::shared_ptr<PieceCatalog<Omino> const> const & catalog = PieceCatalog<Omino>::standard()) const {
+        std::vector<Rating> res(board.size());
+        std::atomic<int> next{0};
+        auto worker = [&](){
+            PackingPuzzle<Omino> puzzle(0, 0, catalog);
+            for(int k = next++; k < (int)board.size(); k = next++){
+                puzzle.board = board[k];
+                if(unuse.empty()) puzzle.unuse.assign(puzzle.base.size(), 1);
+                else puzzle.set_inventory(unuse[k]);
+                res[k] = rate(puzzle);
+            }
+        };
+        int const num = std::max(1, std::min(thread_num > 0 ? thread_num : (int)std::thread::hardware_concurrency(), (int)board.size()));
+        std::vector<std::thread> threads;
+        for(int t=1; t<num; ++t) threads.emplace_back(worker);
+        worker();
+        for(auto & th : threads) th.join();
+        return res;
+    }
+};
+
+} // namespace PolyominoPuzzle
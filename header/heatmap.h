@@ -0,0 +1,122 @@
+/**
+ * @brief 選択中のピースの各配置について残りの解の個数を並列に数える
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "polyomino.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief ピースの全ての配置(位置, 回転・鏡像)ごとの解の個数
+ * @note 配置の一覧は計算の前に一度だけ作り, 各スレッドからは読み取りのみ行う
+ * @note 各スレッドは盤面とキャッシュを持つPackingPuzzleのコピーで数える
+ * @note 盤面・ピースの使用状況・ピースが前回と同じなら計算し直さない
+*/
+template <typename Omino>
+struct PlacementHeatmap{
+    /**
+     * @brief 配置とその解の個数
+    */
+    struct Entry{
+        int pattern;                    // 回転・鏡像のパターン番号
+        Coord pos;                      // 配置場所(aabbの左上, Board::put_pieceと同じ)
+        long long int num = -1;         // 置いた後の解の個数
+    };
+
+    std::vector<Entry> entry;           // 置ける配置の一覧(パターン, x, yの順)
+    int thread_num = 0;                 // 使うスレッド数(0ならハードウェアのスレッド数)
+
+    /**
+     * @brief pieceの全ての配置について解の個数を数える
+     * @param[in] puzzle 現在の盤面と未使用のピース
+     * @param[in] piece 数えるピース番号(未使用であること)
+     * @return 計算し直した場合true, キャッシュを使った場合false
+    */
+    bool update(PackingPuzzle<Omino> const & puzzle, int const piece){
+        if(valid(puzzle, piece)) return false;
+        board = puzzle.board;
+        unuse = puzzle.unuse;
+        this->piece = piece;
+
+        // 配置の一覧(各スレッドで共有, 読み取りのみ)
+        int const h = (int)board.h_size;
+        entry.clear();
+        index.assign(puzzle.kernel[piece].size(), std::vector<int>(board.w_size * board.h_size, -1));
+        for(int j=0; j<(int)puzzle.kernel[piece].size(); ++j){
+            for(int x=0; x<(int)board.w_size; ++x){
+                for(int y=0; y<h; ++y){
+                    if(!board.putable(puzzle.kernel[piece][j], {x, y})) continue;
+                    index[j][x * h + y] = (int)entry.size();
+                    entry.push_back({j, {x, y}});
+                }
+            }
+        }
+
+        // 配置を1つずつ取り出して数える
+        std::atomic<int> next{0};
+        auto worker = [&](){
+            PackingPuzzle<Omino> local = puzzle;
+            --local.unuse[piece];
+            for(int k = next++; k < (int)entry.size(); k = next++){
+                auto const & ker = local.kernel[piece][entry[k].pattern];
+                local.board.put_piece(ker, entry[k].pos, piece);
+                entry[k].num = local.count();
+                local.board.put_piece(ker, entry[k].pos, EMPTY);
+            }
+        };
+        int const num = std::max(1, std::min(thread_num > 0 ? thread_num : (int)std::thread::hardware_concurrency(), (int)entry.size()));
+        std::vector<std::thread> threads;
+        for(int t=1; t<num; ++t) threads.emplace_back(worker);
+        worker();
+        for(auto & th : threads) th.join();
+        return true;
+    }
+
+    /**
+     * @brief 前回の計算結果がpuzzleの現在の状態とpieceのものか
+    */
+    bool valid(PackingPuzzle<Omino> const & puzzle, int const piece) const {
+        return this->piece == piece && unuse == puzzle.unuse && board == puzzle.board;
+    }
+
+    /**
+     * @brief 計算結果を破棄する
+    */
+    void clear(){
+        entry.clear();
+        index.clear();
+        piece = -1;
+    }
+
+    /**
+     * @brief パターンpatternをposに置いた後の解の個数, 置けない・未計算なら-1
+    */
+    long long int num(int const pattern, Coord const pos) const {
+        if(pattern < 0 || pattern >= (int)index.size() || !board.in(pos)) return -1;
+        int const k = index[pattern][pos.x * (int)board.h_size + pos.y];
+        return k < 0 ? -1 : entry[k].num;
+    }
+
+    /**
+     * @brief 解の個数の最大
+    */
+    long long int max_num() const {
+        long long int res = 0;
+        for(auto const & e : entry) res = std::max(res, e.num);
+        return res;
+    }
+
+private:
+    Board board;                                // 計算したときの盤面
+    std::vector<int> unuse;                     // 計算したときのピースの使用状況
+    int piece = -1;                             // 計算したピース番号
+    std::vector<std::vector<int>> index;        // [パターン][x * h + y] -> entryの番号(置けなければ-1)
+};
+
+} // namespace PolyominoPuzzle
@@ -0,0 +1,66 @@
+/**
+ * @brief 最大エントリ数つきのLRUキャッシュ
+*/
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 最後に参照されてから最も時間が経ったものから捨てるキャッシュ
+ * @note 参照・追加ともに平均O(1)
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+struct LruCache{
+    size_t capacity;                    // 最大エントリ数
+
+    LruCache(size_t const _capacity = 1024) : capacity(_capacity){}
+
+    /**
+     * @brief キーの値を探し, 最も新しく参照したものにする
+     * @return 値へのポインタ, なければnullptr
+    */
+    Value const * find(Key const & key){
+        auto it = index.find(key);
+        if(it == index.end()) return nullptr;
+        order.splice(order.begin(), order, it->second);
+        return &it->second->second;
+    }
+
+    /**
+     * @brief キーの値を記録する, 最大エントリ数を超えたら最も古いものを捨てる
+    */
+    void put(Key const & key, Value const & value){
+        auto it = index.find(key);
+        if(it != index.end()){
+            it->second->second = value;
+            order.splice(order.begin(), order, it->second);
+            return;
+        }
+        order.emplace_front(key, value);
+        index.emplace(key, order.begin());
+        while(index.size() > capacity){
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+
+    size_t size() const {
+        return index.size();
+    }
+
+    void clear(){
+        order.clear();
+        index.clear();
+    }
+
+private:
+    std::list<std::pair<Key, Value>> order;     // 新しく参照した順
+    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> index;
+};
+
+} // namespace PolyominoPuzzle
@@ -4,29 +4,95 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include "polyomino.h"
+#include "piece_catalog.h"
+#include "coloring.h"
 
 namespace PolyominoPuzzle{
 
+/**
+ * @brief 盤面が埋められるかの判定結果
+*/
+enum class Feasibility{
+    no,         // 埋められない
+    yes,        // 埋められる
+    unknown,    // 探索の上限に達したため不明
+};
+
+/**
+ * @brief 探索の各深さ(置いたピースの数)での分岐・行き止まりの記録
+*/
+struct SearchProfile{
+    std::vector<long long int> node;        // [深さ] -> ノード数
+    std::vector<long long int> fit;         // [深さ] -> 左上のマスに置けた配置の数の和
+    std::vector<long long int> live;        // [深さ] -> 置いた直後に枝刈りされなかった子の数の和
+    std::vector<long long int> forced;      // [深さ] -> 枝刈りされない子が1つだけのノード数(一手に決まる局面)
+    std::vector<long long int> dead_end;    // [深さ] -> 枝刈りされた, または置ける配置がないノード数
+    long long int solution{};               // 見つかった解の数
+    long long int nodes{};                  // 探索したノード数
+    bool complete{};                        // 上限に達せずに全て探索したか
+};
+
+/**
+ * @brief ランダムな1本道の探索(Knuthの方法)を繰り返して見積もった探索木の大きさ
+ * @note 区間は各試行の平均に対する95%信頼区間(正規近似)で, 解の少ない盤面ほど幅が広い
+*/
+struct TreeEstimate{
+    double solution{}, solution_low{}, solution_high{};     // 解の個数の見積もりと区間
+    double node{}, node_low{}, node_high{};                 // 探索木のノード数の見積もりと区間
+    long long int probe{};                                  // 試行の回数
+    long long int visited{};                                // 試行で辿ったノード数の和
+    double time_ms{};                                       // 見積もりにかかった時間[ms]
+
+    /**
+     * @brief 見積もったノード数を試行と同じ速さで辿る時間[ms]
+     * @note count・solveはキャッシュで辿るノードが減るので, 実際はこれより短いことが多い
+    */
+    double eta_ms() const {
+        return visited > 0 ? node * time_ms / visited : 0;
+    }
+};
+
 
 /**
  * @brief ポリオミノパッキング全般
+ * @note Ominoがポリキューブ(dimensionが3)ならBoard::boxで作った三次元の盤面を解く, 配置のビット表現・枝刈り・キャッシュは二次元と共通
 */
 template <typename Omino>
 struct PackingPuzzle{
-    std::vector<Omino> base;                    // ベースとなるポリオミノ
-    std::vector<std::vector<Omino>> pattern;    // baseの回転や鏡像を考えたポリオミノ
-    std::vector<int> unuse;                     // 各ピースの使用状況
+    std::shared_ptr<PieceCatalog<Omino> const> catalog;         // 共有するピースのデータ
+    std::vector<Omino> const & base;                            // ベースとなるポリオミノ(catalogのもの)
+    std::vector<std::vector<Omino>> const & pattern;            // baseの回転や鏡像を考えたポリオミノ(catalogのもの)
+    std::vector<std::vector<typename Omino::Kernel>> const & kernel;    // patternごとの配置判定・配置用のカーネル(catalogのもの)
+    std::vector<int> unuse;                     // 各ピースの残りの個数(通常は1個ずつで, 使用済みなら0)
     Board board;                                // 現在の盤面
     std::vector<Board> ans;                     // 答えのパターン
     int ignore_piece = -1;                      // 鏡像対称性があり回転対称性がないポリオミノ番号(未使用)
     long long int iterate_num{};
+    long long int cache_hit{}, cache_miss{};    // fillable_cache, tiling_cache, count_cacheの参照結果
+    int small_area_limit{};                     // キャッシュを使う領域の最大マス数(0ならキャッシュを使わない)
+    size_t fillable_cache_max = 1 << 20;        // fillable_cache, tiling_cacheの最大エントリ数
 
-    PackingPuzzle(size_t const _w = 0, size_t const _h = 0) : board(_w, _h, EMPTY){
+    /**
+     * @note ピースのデータはcatalogを参照するだけなので, 作るコストは盤面の準備のみ
+     * @note base, pattern, kernelは参照のため代入はできない(コピーの構築はできる)
+    */
+    PackingPuzzle(size_t const _w = 0, size_t const _h = 0, std::shared_ptr<PieceCatalog<Omino> const> _catalog = PieceCatalog<Omino>::standard())
+        : catalog(std::move(_catalog)), base(catalog->base), pattern(catalog->pattern), kernel(catalog->kernel), board(_w, _h, EMPTY){
         init();
     }
 
-    PackingPuzzle(std::vector<std::string> const & b) : board(b){
+    PackingPuzzle(std::vector<std::string> const & b, std::shared_ptr<PieceCatalog<Omino> const> _catalog = PieceCatalog<Omino>::standard())
+        : catalog(std::move(_catalog)), base(catalog->base), pattern(catalog->pattern), kernel(catalog->kernel), board(b){
         init();
     }
 
@@ -34,15 +100,12 @@ struct PackingPuzzle{
      * @brief 初期化
     */
     void init(){
-        // まずbase取得
-        Omino::enumeration(base);
-        // 回転・鏡像のパターンを取得
-        Omino::pattern_enumeration(pattern, base);
         // 盤面をEMPTYに
         board.fill(EMPTY);
         // サイズなど変更
-        unuse.resize(base.size(), true);
+        unuse.assign(base.size(), true);
         ans.clear();
+        small_area_limit = 4 * catalog->max_size;
         // 重複を除去するためのポリオミノを一つ選択
         // for(int i=0; i<(int)base.size(); ++i){
         //     if(!base[i].reflectionity()) continue;
@@ -57,11 +120,395 @@ struct PackingPuzzle{
      * @brief パズルを解き、ansを更新する
      * @param[in] place 配置場所(再帰の際の効率化用, 設定の必要なし)
      * @param[in] depth 現在の深さ
-     * @param[in] flag_ignore 特定のピースの回転を固定化し重複解の出現を抑える
+     * @note 盤面をちょうど埋める場合は, 配置で孤立した小さな領域をfillable_cacheで調べて枝刈りする
+    */
+    void solve(Coord place = {0, 0}, int const depth = 0){
+        init_search();
+        solve_depth = depth + remain_num();
+        solve_exact = (empty_num == remain_area());
+        coverage_active = coverage_active && solve_exact;
+        solve_rec(place, depth, solve_exact);
+    }
+
+    /**
+     * @brief 解の個数のみを数える(ansは更新しない)
+     * @note 空きマスが複数の領域に分かれた場合は最も小さい領域から数え, 残りの領域の個数と掛け合わせる
+     * @note 空きマスの面積が残りのピースの面積の和と一致しない場合は0
+     * @note ピースが64個を超える場合は領域の分解を行わず愚直に数える
+    */
+    long long int count(){
+        init_search();
+        if(empty_num != remain_area()) return 0;
+        return count_fill({0, 0}, true);
+    }
+
+    /**
+     * @brief 残りのピースを全て使って盤面のEMPTYを埋められるか(最初の解が見つかった時点で打ち切る)
+     * @param[in] node_limit 探索するノード数の上限(負なら無制限)
+     * @param[in] time_limit 探索時間の上限[ms](負なら無制限)
+     * @return 埋められればyes, 埋められなければno, 上限に達した場合はunknown
+     * @note 彩色・孤立した領域・覆えないマスによる枝刈りを全て使い, count_cacheに記録があればそれを使う
+     * @note 多数の盤面を調べる場合は, 同じPackingPuzzleのboardとunuseを差し替えて呼ぶとキャッシュが再利用される
+    */
+    Feasibility feasible(long long int const node_limit = -1, double const time_limit = -1){
+        init_search();
+        if(empty_num != remain_area()) return Feasibility::no;
+        search_node = 0;
+        search_node_limit = node_limit;
+        search_time_limit = time_limit;
+        search_start = std::chrono::steady_clock::now();
+        search_abort = false;
+        if(find_fill({0, 0}, true)) return Feasibility::yes;
+        return search_abort ? Feasibility::unknown : Feasibility::no;
+    }
+
+    /**
+     * @brief 解の個数をlimit個まで数える(limit個見つかった時点で打ち切る)
+     * @param[in] limit 数える上限(唯一解かどうかを調べるなら2)
+     * @param[in] node_limit 探索するノード数の上限(負なら無制限)
+     * @param[in] time_limit 探索時間の上限[ms](負なら無制限)
+     * @return min(解の個数, limit), ノード数・時間の上限に達した場合は-1
+     * @note feasibleと同じ枝刈り・キャッシュを使い, 空きマスが分断されれば領域ごとの個数を掛け合わせる
+    */
+    long long int count_upto(long long int const limit, long long int const node_limit = -1, double const time_limit = -1){
+        init_search();
+        if(empty_num != remain_area() || limit <= 0) return 0;
+        search_node = 0;
+        search_node_limit = node_limit;
+        search_time_limit = time_limit;
+        search_start = std::chrono::steady_clock::now();
+        search_abort = false;
+        long long int const res = count_bounded({0, 0}, true, limit);
+        return search_abort ? -1 : res;
+    }
+
+    /**
+     * @brief 解の個数と探索木のノード数をランダムな試行で見積もる
+     * @param[in] time_limit 見積もりにかける時間[ms](少なくとも1回は試行する)
+     * @param[in] probe_limit 試行の回数の上限(負なら時間のみで打ち切る)
+     * @param[in] seed 乱数の種
+     * @param[in] exact_area 残りの空きマスがこれ以下になったら, その部分木の解はcountと同じ方法で正確に数える(負ならピース6個分)
+     * @note 各試行は根から, 置ける配置の中から一様に1つ選んで進み, 分岐数の積を重みとして通ったノードと解に足す(重みの期待値が真の値になる)
+     * @note 解は葉の近くにしかないので, 残りが小さくなった部分木は正確に数えて重みを掛ける(count_cacheが試行の間で効く)
+     * @note 彩色・孤立した領域・覆えないマスで枝刈りした木を辿るので, ノード数はprofileで辿る数の見積もり
+    */
+    TreeEstimate estimate(double const time_limit, long long int const probe_limit = -1, unsigned long long const seed = 1, int const exact_area = -1){
+        init_search();
+        probe_exact_area = (exact_area < 0 ? 6 * catalog->max_size : exact_area);
+        TreeEstimate res;
+        if(empty_num != remain_area()) return res;
+        auto const start = std::chrono::steady_clock::now();
+        std::mt19937_64 rng(seed);
+        double sum_s = 0, sum_s2 = 0, sum_n = 0, sum_n2 = 0;
+        long long int const node0 = iterate_num;
+        do{
+            double node = 0, sol = 0;
+            probe_rec({0, 0}, true, 1.0, rng, node, sol);
+            ++res.probe;
+            sum_s += sol;
+            sum_s2 += sol * sol;
+            sum_n += node;
+            sum_n2 += node * node;
+            res.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }while(res.time_ms < time_limit && (probe_limit < 0 || res.probe < probe_limit));
+        res.visited = iterate_num - node0;
+
+        double const n = (double)res.probe;
+        auto interval = [&](double const sum, double const sum2, double & mean, double & low, double & high){
+            mean = sum / n;
+            double const var = (n > 1 ? std::max(0.0, (sum2 - sum * sum / n) / (n - 1)) : mean * mean);
+            double const half = 1.96 * std::sqrt(var / n);
+            low = std::max(0.0, mean - half);
+            high = mean + half;
+        };
+        interval(sum_s, sum_s2, res.solution, res.solution_low, res.solution_high);
+        interval(sum_n, sum_n2, res.node, res.node_low, res.node_high);
+        return res;
+    }
+
+    /**
+     * @brief 全ての解を探索しながら, 深さごとの分岐数・一手に決まる局面・行き止まりを記録する(難易度の評価用)
+     * @param[in] node_limit 探索するノード数の上限(負なら無制限)
+     * @param[in] time_limit 探索時間の上限[ms](負なら無制限)
+     * @note 彩色・孤立した領域・覆えないマスによる枝刈りは使うが, count_cacheや領域ごとの掛け算は使わない(局面を1つずつ辿る)
+     * @note 上限に達した場合はそこまでの記録を返し, completeはfalse
+    */
+    SearchProfile profile(long long int const node_limit = -1, double const time_limit = -1){
+        init_search();
+        SearchProfile res;
+        if(empty_num != remain_area()){
+            res.complete = true;
+            return res;
+        }
+        search_node = 0;
+        search_node_limit = node_limit;
+        search_time_limit = time_limit;
+        search_start = std::chrono::steady_clock::now();
+        search_abort = false;
+        profile_rec({0, 0}, true, 0, res);
+        res.nodes = std::min(search_node, node_limit < 0 ? search_node : node_limit);
+        res.complete = !search_abort;
+        return res;
+    }
+
+    /**
+     * @brief 未使用のピースから選んだ部分集合(各ピースは残りの個数まで)で盤面のEMPTYをちょうど埋める埋め方を1つずつ列挙する
+     * @param[in] piece_num 使うピースの数(負なら任意)
+     * @param[in] f 埋め方ごとに(盤面, 使ったピースの個数をpiece_countで取り出せる値)で呼ぶ関数, falseを返すと列挙を打ち切る
+     * @return 列挙した埋め方の数
+     * @note 面積・残りのピースの数・彩色・孤立した領域・覆えないマスで枝刈りする
+     * @note 個数のビット表現が64ビットに収まる場合のみ(1個ずつなら64種類まで, それ以外は0)
+    */
+    template <typename Func>
+    long long int solve_subset(int const piece_num, Func && f){
+        init_search();
+        if(!flag_decompose) return 0;
+        subset_piece_num = piece_num;
+        subset_num = 0;
+        subset_stop = false;
+        solve_subset_rec({0, 0}, 0ULL, true, f);
+        return subset_num;
+    }
+
+    /**
+     * @brief 盤面のEMPTYをちょうど埋められるピースの部分集合を, 見つかった順に1回ずつ列挙する
+     * @param[in] piece_num 使うピースの数(負なら任意)
+     * @param[in] f 部分集合(ピースの個数をpiece_countで取り出せる値, 1個ずつならビットマスク)ごとに呼ぶ関数, falseを返すと列挙を打ち切る
+     * @return 列挙した部分集合の数
+     * @note 残りが小さな領域になったらtiling_cacheの(ピースの集合, 個数)をまとめて使い, 同じ集合の埋め方を1つずつ辿らない(未使用のピースが多すぎない場合)
+     * @note 列挙済みの部分集合を覚えておくので, メモリは見つかった部分集合の数に比例する
+    */
+    template <typename Func>
+    long long int list_subsets(int const piece_num, Func && f){
+        init_search();
+        if(!flag_decompose) return 0;
+        subset_piece_num = piece_num;
+        subset_num = 0;
+        subset_stop = false;
+        subset_found.clear();
+        list_subsets_rec({0, 0}, 0ULL, true, f);
+        subset_found.clear();
+        return subset_num;
+    }
+
+    /**
+     * @brief ピースの在庫を設定する(同じ形のピースを複数個使う場合)
+     * @param[in] num [ピース] -> 個数
+     * @note 同じ形のピースは区別せず, 配置の探索でも形ごとに1回ずつしか試さないので, 入れ替えただけの解は数えない
+    */
+    void set_inventory(std::vector<int> const & num){
+        unuse = num;
+    }
+
+    /**
+     * @brief 未使用のピースの面積の和
+    */
+    int remain_area() const {
+        int res = 0;
+        for(int i=0; i<(int)base.size(); ++i) res += unuse[i] * (int)base[i].size();
+        return res;
+    }
+
+    /**
+     * @brief 未使用のピースの個数の和
+    */
+    int remain_num() const {
+        int res = 0;
+        for(auto const u : unuse) res += u;
+        return res;
+    }
+
+    /**
+     * @brief solve_subset, list_subsetsが渡すピースの集合から, ピースiの個数を取り出す
+    */
+    int piece_count(unsigned long long const used, int const i) const {
+        return (int)((used >> piece_shift[i]) & ((1ULL << piece_width[i]) - 1));
+    }
+
+    ColoringPruner pruner;                      // 彩色による枝刈り, colorings を差し替えて使う
+    bool flag_coverage = true;                  // どの配置でも覆えないマスができたら枝刈りするか(64マス以下で長方形でない盤面のみ)
+    long long int coverage_cut{};               // 覆えないマスによって枝刈りした回数
+
+private:
+    /**
+     * @brief 64マス以下の盤面でのパターンのビット表現
+     * @note パターンの(0,0)を置くマスの番号(Board::index)だけシフトすれば配置したマスのビットになる
+     * @note 盤面に収まるかはanchorのビットだけで判定するので, 二次元と三次元で同じ表を使う
+    */
+    struct Span{
+        unsigned long long mask{};              // (0,0)をマス0に置いたときのビット
+        unsigned long long anchor{};            // (0,0)を置いて盤面内に収まるマスのビット
+        std::array<int, 16> offset{};           // 各マスの(0,0)からのビットの位置の差(16マスまで)
+        int size{};
+    };
+
+    /**
+     * @brief fillable_cache, tiling_cache, count_cacheのキー
+     * @note 回転・鏡像のうち最小の形を, 外接長方形の中で列優先(x * h + y)に並べたビット列で表す
+     * @note 64マス以下の盤面では盤面上のビットを平行移動したものをloに入れ, hに盤面の高さの符号を反転したものを入れる
+    */
+    struct AreaKey{
+        unsigned long long lo{}, hi{};          // 形のビット列(128ビット)
+        unsigned long long piece{};             // 残りのピース
+        int h{};                                // 外接長方形の高さ
+
+        bool operator == (AreaKey const & rhs) const {
+            return lo == rhs.lo && hi == rhs.hi && piece == rhs.piece && h == rhs.h;
+        }
+    };
+
+    struct AreaKeyHash{
+        size_t operator () (AreaKey const & k) const {
+            unsigned long long v = k.lo * 0x9E3779B97F4A7C15ULL;
+            v ^= (k.hi + (unsigned long long)k.h) * 0xC2B2AE3D27D4EB4FULL;
+            v ^= k.piece * 0x165667B19E3779F9ULL;
+            return (size_t)(v ^ (v >> 29));
+        }
+    };
+
+    std::vector<std::vector<Span>> span;        // [ピース][パターン] -> ビット表現
+    size_t span_w{}, span_h{}, span_d{};        // spanを作ったときの盤面のサイズ
+    int empty_num{};                            // 盤面に残っているEMPTYの数(探索中のみ有効)
+    bool solve_exact{};                         // solveで盤面をちょうど埋めるかどうか
+    bool coverage_active{};                     // 覆えないマスによる枝刈りを行うか(盤面をちょうど埋める場合のみ)
+    bool flag_decompose{};                      // 領域ごとに分解して数えるか(ピースの個数のビット表現が64ビット以下)
+    std::vector<int> piece_shift, piece_width;  // ピースの集合のビット表現での各ピースの個数の位置と幅(1個ずつならi, 1)
+    int piece_bits{};                           // ピースの集合のビット表現の幅
+    int solve_depth{};                          // solveで置くピースの数
+    bool flag_bits{};                           // 盤面が64マス以下でempty_bitsを使うか
+    unsigned long long empty_bits{};            // EMPTYなマスのビット(Board::index, 二次元ではx * h_size + y)
+    unsigned long long region_bits{};           // for_each_fitで配置を限定する領域のビット
+    unsigned long long not_top{}, not_bottom{}; // 上端・下端の行以外のマスのビット
+    unsigned long long not_front{}, not_back{}; // 手前(z = 0)・奥(z = d_size - 1)の層以外のマスのビット
+    std::vector<int> visit_stamp;               // 連結成分探索用の訪問記録
+    int stamp{};
+    std::vector<unsigned long long> area_bits;  // split_areasの結果(64マス以下の盤面)
+    std::vector<Coord> area_cells;              // split_areasの結果(領域ごとに連続して並ぶ)
+    std::vector<int> area_begin;                // 各領域のarea_cellsでの開始位置(末尾に番兵)
+    std::vector<int> region_mark;               // 探索を限定する領域の記録
+    int region_stamp{};
+    int active_region{};                        // for_each_fitで配置を限定する領域(0なら限定なし)
+    std::vector<Coord> key_cells;               // area_keyの作業用
+    std::unordered_map<AreaKey, bool, AreaKeyHash> fillable_cache;  // (孤立領域の正規形, 残りのピース) -> 埋められるかどうか
+    std::unordered_map<AreaKey, std::vector<std::pair<unsigned long long, long long int>>, AreaKeyHash> tiling_cache;  // (孤立領域の正規形, 残りのピース) -> count_areaの結果
+    struct CountEntry{
+        AreaKey key;
+        long long int num = -1;                 // 負なら空き
+    };
+    long long int search_node{};                // feasibleで探索したノード数
+    long long int search_node_limit{};          // feasibleで探索するノード数の上限(負なら無制限)
+    double search_time_limit{};                 // feasibleの探索時間の上限[ms](負なら無制限)
+    std::chrono::steady_clock::time_point search_start;
+    bool search_abort{};                        // feasibleの探索を上限で打ち切ったか
+    std::vector<CountEntry> count_cache;        // (残りの空きマスの正規形, 残りのピース) -> count_fillの結果, ハッシュ値の下位ビットの位置に上書きで記録
+    int subset_piece_num{};                     // solve_subset, list_subsetsで使うピースの数(負なら任意)
+    long long int subset_num{};                 // solve_subset, list_subsetsで列挙した数
+    bool subset_stop{};                         // solve_subset, list_subsetsの列挙を打ち切るか
+    std::unordered_set<unsigned long long> subset_found;    // list_subsetsで列挙済みの部分集合
+    int probe_exact_area{};                     // estimateで部分木を正確に数える残りの空きマスの数
+
+    /**
+     * @brief 探索前に盤面の状態から作業用の値を準備する
+    */
+    void init_search(){
+        empty_num = 0;
+        for(auto const & col : board.board){
+            for(auto const v : col) empty_num += (v == EMPTY);
+        }
+        init_piece_bits();
+        flag_decompose = (piece_bits <= 64);
+        flag_bits = (board.cell_num() <= 64);
+        empty_bits = not_top = not_bottom = not_front = not_back = 0;
+        region_bits = ~0ULL;
+        if(flag_bits && (span.empty() || span_w != board.w_size || span_h != board.h_size || span_d != board.d_size)){
+            // 配置のビット表現は盤面のサイズのみで決まるので, 同じサイズの盤面が続く間は作り直さない
+            span_w = board.w_size;
+            span_h = board.h_size;
+            span_d = board.d_size;
+            span.assign(pattern.size(), {});
+            for(int i=0; i<(int)pattern.size(); ++i){
+                for(auto const & shape : pattern[i]){
+                    Span sp;
+                    Coord lo{}, hi{};
+                    for(int k=0; k<(int)shape.size(); ++k){
+                        // 左上を(0,0)にしているので, 他のマスの番号は(0,0)より大きい
+                        int const offset = board.index(shape[k]);
+                        sp.mask |= 1ULL << offset;
+                        lo = {std::min(lo.x, shape[k].x), std::min(lo.y, shape[k].y), std::min(lo.z, shape[k].z)};
+                        hi = {std::max(hi.x, shape[k].x), std::max(hi.y, shape[k].y), std::max(hi.z, shape[k].z)};
+                        if(k < (int)sp.offset.size()) sp.offset[sp.size++] = offset;
+                    }
+                    for(int k=0; k<board.cell_num(); ++k){
+                        Coord const c = board.coord(k);
+                        if(board.in(c + lo) && board.in(c + hi)) sp.anchor |= 1ULL << k;
+                    }
+                    span[i].push_back(std::move(sp));
+                }
+            }
+        }
+        if(flag_bits){
+            for(int k=0; k<board.cell_num(); ++k){
+                Coord const c = board.coord(k);
+                unsigned long long const bit = 1ULL << k;
+                if(board[c] == EMPTY) empty_bits |= bit;
+                if(c.y != 0) not_top |= bit;
+                if(c.y != (int)board.h_size - 1) not_bottom |= bit;
+                if(c.z != 0) not_front |= bit;
+                if(c.z != (int)board.d_size - 1) not_back |= bit;
+            }
+        }
+        visit_stamp.assign(board.cell_num(), 0);
+        region_mark.assign(board.cell_num(), 0);
+        stamp = region_stamp = active_region = 0;
+        // 何もない長方形の盤面では枝刈りより判定の負荷の方が大きいので, 埋まったマスやHOLEがある場合のみ
+        coverage_active = flag_coverage && flag_bits && empty_num < board.cell_num();
+        for(auto const & b : base) coverage_active = coverage_active && b.size() <= Span().offset.size();
+        if(count_cache.empty()) count_cache.resize(1 << 18);
+        pruner.init(board, kernel, unuse);
+    }
+
+    /**
+     * @brief ピースの集合(個数)のビット表現を準備する
+     * @note 幅は今までの最大の個数が収まるように広げるだけなので, 1個ずつの在庫では常にピースiがビットiになる
+     * @note 幅が変わるとキャッシュのキーの意味が変わるので, キャッシュを捨てる
     */
-    void solve(Coord place = {0, 0}, int const depth = 0, bool flag_ignore = true){
+    void init_piece_bits(){
+        bool changed = (piece_width.size() != base.size());
+        if(changed) piece_width.assign(base.size(), 1);
+        for(int i=0; i<(int)base.size(); ++i){
+            int const w = std::max(1, (int)std::bit_width((unsigned int)std::max(unuse[i], 0)));
+            if(w <= piece_width[i]) continue;
+            piece_width[i] = w;
+            changed = true;
+        }
+        if(!changed) return;
+        piece_shift.assign(base.size(), 0);
+        piece_bits = 0;
+        for(int i=0; i<(int)base.size(); ++i){
+            piece_shift[i] = piece_bits;
+            piece_bits += piece_width[i];
+        }
+        fillable_cache.clear();
+        tiling_cache.clear();
+        count_cache.clear();
+    }
+
+    /**
+     * @brief ピースの集合のビット表現に含まれるピースの個数の和
+    */
+    int piece_total(unsigned long long const used) const {
+        int res = 0;
+        for(int i=0; i<(int)base.size(); ++i) res += piece_count(used, i);
+        return res;
+    }
+
+    /**
+     * @brief solveの本体
+     * @param[in] check_split 空きマスが分断されている可能性があるか(盤面をちょうど埋める場合のみ)
+    */
+    void solve_rec(Coord place, int const depth, bool const check_split){
         // 末端まで来たら終了
-        if(depth >= (int)pattern.size()){
+        if(depth >= solve_depth){
             // std::cout << "【解に追加】" << std::endl;
             ans.emplace_back(board);
             return;
@@ -76,45 +523,783 @@ struct PackingPuzzle{
 
         ++iterate_num;
 
-        // ポリオミノを選択
-        for(int i=0; i<(int)pattern.size(); ++i){
-            // 使っていないかどうか
+        // 彩色による枝刈り
+        if(!pruner.feasible(true, solve_exact)) return;
+
+        // 孤立した領域が埋められなければ枝刈り
+        if(check_split && split_areas(place) > 1 && !fillable_areas(true)) return;
+
+        // どの配置でも覆えないマスがあれば枝刈り
+        if(coverage_active && has_dead_cell()) return;
+
+        // 置ける場合は置いて深さ+1へ
+        for_each_fit(place, [&](int const i, int const j){ solve_rec(place, depth+1, solve_exact && (flag_bits || may_split(i, j, place))); });
+    }
+
+    /**
+     * @brief placeにパターン(i, j)を置いた直後に, 空きマスが分断された可能性があるか
+     * @note 置く前の空きマスが連結なら, 分断後の各領域はピースの4近傍の空きマスを含む
+     * @note 周囲のマスだけを通ってそれらが全て繋がっていれば分断されていない
+    */
+    bool may_split(int const i, int const j, Coord const place) const {
+        PieceHalo const & h = catalog->halo[i][j];
+        if(!h.valid) return true;
+        unsigned long long empty = 0;
+        for(int a=0; a<(int)h.cell.size(); ++a){
+            Coord c = place + h.cell[a];
+            if(board.in(c) && board[c] == EMPTY) empty |= 1ULL << a;
+        }
+        unsigned long long const start = empty & h.touch;
+        if(start == 0) return false;
+
+        unsigned long long reach = start & -start, front = reach;
+        while(front){
+            int const a = std::countr_zero(front);
+            front &= front - 1;
+            unsigned long long next = h.adj[a] & empty & ~reach;
+            reach |= next;
+            front |= next;
+        }
+        return (start & ~reach) != 0;
+    }
+
+    /**
+     * @brief place以降のEMPTYを連結成分に分ける
+     * @param[in] place 最も左上のEMPTY
+     * @return 領域の数
+     * @note 64マス以下の盤面ではビット演算で塗りつぶしてarea_bitsに, それ以外は幅優先探索でarea_cells, area_beginに入れる
+     * @note 三次元の盤面では6近傍で繋がったマスを同じ領域とする
+    */
+    int split_areas(Coord const place){
+        Coord const near[6] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}, {0, 0, 1}, {0, 0, -1}};
+        int const h = (int)board.h_size;
+        int const d = (int)board.d_size;
+        area_bits.clear();
+        area_cells.clear();
+        area_begin.clear();
+
+        if(flag_bits){
+            // マスの番号は探索順と一致するので, 最下位ビットから塗りつぶせば領域も探索順に並ぶ
+            // y方向は1, z方向はh, x方向はd * hだけビットがずれる
+            unsigned long long rest = empty_bits;
+            while(rest){
+                unsigned long long reach = rest & -rest, prev = 0;
+                while(reach != prev){
+                    prev = reach;
+                    reach |= ((reach << 1) & not_top) | ((reach >> 1) & not_bottom) | (reach << (d * h)) | (reach >> (d * h));
+                    if(d > 1) reach |= ((reach << h) & not_front) | ((reach >> h) & not_back);
+                    reach &= empty_bits;
+                }
+                area_bits.push_back(reach);
+                rest &= ~reach;
+            }
+            return (int)area_bits.size();
+        }
+
+        ++stamp;
+        int const start = place.x * d + place.z;
+        for(int col=start; col<(int)board.board.size(); ++col){
+            for(int y=(col == start ? place.y : 0); y<h; ++y){
+                if(board.board[col][y] != EMPTY || visit_stamp[col * h + y] == stamp) continue;
+                area_begin.push_back((int)area_cells.size());
+                area_cells.push_back({col / d, y, col % d});
+                visit_stamp[col * h + y] = stamp;
+                for(int k=area_begin.back(); k<(int)area_cells.size(); ++k){
+                    for(int l=0; l<(d == 1 ? 4 : 6); ++l){
+                        Coord n = area_cells[k] + near[l];
+                        if(!board.in(n) || board[n] != EMPTY) continue;
+                        int const idx = board.index(n);
+                        if(visit_stamp[idx] == stamp) continue;
+                        visit_stamp[idx] = stamp;
+                        area_cells.push_back(n);
+                    }
+                }
+            }
+        }
+        int const num = (int)area_begin.size();
+        area_begin.push_back((int)area_cells.size());
+        return num;
+    }
+
+    /**
+     * @brief split_areasの領域の数
+    */
+    int area_num() const {
+        return flag_bits ? (int)area_bits.size() : (int)area_begin.size() - 1;
+    }
+
+    /**
+     * @brief split_areasの領域idxのマスの数
+    */
+    int area_size(int const idx) const {
+        return flag_bits ? std::popcount(area_bits[idx]) : area_begin[idx+1] - area_begin[idx];
+    }
+
+    /**
+     * @brief split_areasの領域idxのマスを取り出す(左上から右下への探索順にソート)
+    */
+    std::vector<Coord> get_area(int const idx) const {
+        std::vector<Coord> res;
+        if(flag_bits){
+            for(unsigned long long b = area_bits[idx]; b; b &= b - 1) res.push_back(board.coord(std::countr_zero(b)));
+            return res;
+        }
+        res.assign(area_cells.begin() + area_begin[idx], area_cells.begin() + area_begin[idx+1]);
+        std::sort(res.begin(), res.end());
+        return res;
+    }
+
+    /**
+     * @brief 残りのピースを全て使って盤面のEMPTYを埋める方法の個数
+     * @param[in] place 配置場所(再帰の際の効率化用)
+     * @param[in] check_split 空きマスが分断されている可能性があるか
+     * @note 空きマスの面積と残りのピースの面積の和が等しいことが前提
+    */
+    long long int count_fill(Coord place, bool const check_split){
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0) return 1;
+        ++iterate_num;
+        if(!pruner.feasible(true, true)) return 0;
+
+        // 残りが小さな一つの領域ならcount_cacheを参照し, なければ数えた後に記録する
+        AreaKey key;
+        bool flag_memo = false;
+        if(check_split || (flag_decompose && empty_num <= small_area_limit)){
+            int const num = split_areas(place);
+            if(num > 1){
+                if(!fillable_areas(false)) return 0;
+                if(flag_decompose) return count_split(place);
+            }else if(flag_decompose && empty_num <= small_area_limit && area_key(0, key)){
+                CountEntry const & e = count_cache[AreaKeyHash()(key) & (count_cache.size() - 1)];
+                if(e.num >= 0 && e.key == key){
+                    ++cache_hit;
+                    return e.num;
+                }
+                ++cache_miss;
+                flag_memo = true;
+            }
+        }
+
+        // どの配置でも覆えないマスがあれば枝刈り
+        if(coverage_active && has_dead_cell()) return 0;
+
+        long long int res = 0;
+        for_each_fit(place, [&](int const i, int const j){ res += count_fill(place, flag_bits || may_split(i, j, place)); });
+        if(flag_memo){
+            count_cache[AreaKeyHash()(key) & (count_cache.size() - 1)] = {key, res};
+        }
+        return res;
+    }
+
+    /**
+     * @brief feasibleの本体, 残りのピースを全て使ってEMPTYを埋める方法が1つでもあるか
+     * @param[in] place 配置場所(再帰の際の効率化用)
+     * @param[in] check_split 空きマスが分断されている可能性があるか
+     * @note 上限に達したらsearch_abortを立ててfalseを返す
+    */
+    bool find_fill(Coord place, bool const check_split){
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0) return true;
+        ++iterate_num;
+        if(search_over()) return false;
+        if(!pruner.feasible(true, true)) return false;
+
+        if(check_split || (flag_decompose && empty_num <= small_area_limit)){
+            int const num = split_areas(place);
+            AreaKey key;
+            if(num > 1){
+                if(!fillable_areas(true)) return false;
+            }else if(flag_decompose && empty_num <= small_area_limit && area_key(0, key)){
+                CountEntry const & e = count_cache[AreaKeyHash()(key) & (count_cache.size() - 1)];
+                if(e.num >= 0 && e.key == key){
+                    ++cache_hit;
+                    return e.num > 0;
+                }
+            }
+        }
+
+        if(coverage_active && has_dead_cell()) return false;
+
+        bool found = false;
+        for_each_fit(place, [&](int const i, int const j){
+            if(found || search_abort) return;
+            found = find_fill(place, flag_bits || may_split(i, j, place));
+        });
+        return found;
+    }
+
+    /**
+     * @brief estimateの1回の試行, 置ける配置から一様に1つ選んで進む
+     * @param[in] weight ここまでの分岐数の積
+     * @param[in,out] node 通ったノードの重みの和
+     * @param[in,out] sol 辿り着いた解の重み
+     * @param[in] counted 祖先で部分木の解を数えたか
+    */
+    template <typename Rng>
+    void probe_rec(Coord place, bool const check_split, double const weight, Rng & rng, double & node, double & sol, bool counted = false){
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0){
+            if(!counted) sol += weight;
+            return;
+        }
+        if(!counted && empty_num <= probe_exact_area){
+            // 部分木を数えた後もノード数の見積もりのために試行を続ける
+            sol += weight * count_fill(place, true);
+            counted = true;
+        }
+        ++iterate_num;
+        node += weight;
+        if(!pruner.feasible(true, true)) return;
+        if(check_split && split_areas(place) > 1 && !fillable_areas(true)) return;
+        if(coverage_active && has_dead_cell()) return;
+
+        int fit = 0;
+        for_each_fit(place, [&](int, int){ ++fit; });
+        if(fit == 0) return;
+        int const pick = (int)(rng() % (unsigned long long)fit);
+        int k = 0;
+        for_each_fit(place, [&](int const i, int const j){
+            if(k++ == pick) probe_rec(place, flag_bits || may_split(i, j, place), weight * fit, rng, node, sol, counted);
+        });
+    }
+
+    /**
+     * @brief profileの本体
+     * @return 枝刈りされずに子を試したノード(または解)ならtrue
+    */
+    bool profile_rec(Coord place, bool const check_split, int const depth, SearchProfile & prof){
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0){
+            ++prof.solution;
+            return true;
+        }
+        ++iterate_num;
+        if(search_over()) return true;
+        if((int)prof.node.size() <= depth){
+            for(auto * v : {&prof.node, &prof.fit, &prof.live, &prof.forced, &prof.dead_end}) v->resize(depth + 1);
+        }
+        ++prof.node[depth];
+        bool dead = !pruner.feasible(true, true);
+        if(!dead && check_split && split_areas(place) > 1) dead = !fillable_areas(true);
+        if(!dead && coverage_active) dead = has_dead_cell();
+        if(dead){
+            ++prof.dead_end[depth];
+            return false;
+        }
+
+        long long int fit = 0, live = 0;
+        for_each_fit(place, [&](int const i, int const j){
+            if(search_abort) return;
+            ++fit;
+            live += profile_rec(place, flag_bits || may_split(i, j, place), depth+1, prof);
+        });
+        prof.fit[depth] += fit;
+        prof.live[depth] += live;
+        if(live == 1) ++prof.forced[depth];
+        if(fit == 0) ++prof.dead_end[depth];
+        return fit > 0;
+    }
+
+    /**
+     * @brief count_uptoの本体, 残りのピースを全て使ってEMPTYを埋める方法をlimit個まで数える
+     * @return min(個数, limit), 上限に達したらsearch_abortを立てる
+    */
+    long long int count_bounded(Coord place, bool const check_split, long long int const limit){
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0) return 1;
+        ++iterate_num;
+        if(search_over()) return 0;
+        if(!pruner.feasible(true, true)) return 0;
+
+        if(check_split || (flag_decompose && empty_num <= small_area_limit)){
+            int const num = split_areas(place);
+            AreaKey key;
+            if(num > 1){
+                if(!fillable_areas(true)) return 0;
+                if(flag_decompose) return count_split_bounded(place, limit);
+            }else if(flag_decompose && empty_num <= small_area_limit && area_key(0, key)){
+                // count_cacheの値は打ち切らずに数えた個数なので, そのまま使える
+                CountEntry const & e = count_cache[AreaKeyHash()(key) & (count_cache.size() - 1)];
+                if(e.num >= 0 && e.key == key){
+                    ++cache_hit;
+                    return std::min(e.num, limit);
+                }
+            }
+        }
+
+        if(coverage_active && has_dead_cell()) return 0;
+
+        long long int res = 0;
+        for_each_fit(place, [&](int const i, int const j){
+            if(res >= limit || search_abort) return;
+            res += count_bounded(place, flag_bits || may_split(i, j, place), limit - res);
+        });
+        return std::min(res, limit);
+    }
+
+    /**
+     * @brief count_splitのlimit個で打ち切る版
+     * @note 最も小さい領域の埋め方ごとの個数numに対し, 残りの領域はlimit / numの切り上げ個まで数えれば足りる
+    */
+    long long int count_split_bounded(Coord const place, long long int const limit){
+        int smallest = 0;
+        for(int i=1; i<area_num(); ++i){
+            if(area_size(i) < area_size(smallest)) smallest = i;
+        }
+        std::vector<Coord> area = get_area(smallest);
+        std::vector<std::pair<unsigned long long, long long int>> tmp;
+        auto const & masks = area_tilings(smallest, tmp);
+
+        long long int res = 0;
+        set_area(area, INVALID);
+        for(auto const & [mask, num] : masks){
+            if(res >= limit || search_abort) break;
+            set_unuse(mask, false);
+            res += num * count_bounded(place, true, (limit - res + num - 1) / num);
+            set_unuse(mask, true);
+        }
+        set_area(area, EMPTY);
+        return std::min(res, limit);
+    }
+
+    /**
+     * @brief 面積areaが, 未使用のピースのnum個(負なら個数は任意)の面積の和になりうるか
+     * @note ピースのマス数が全て同じなら割り算のみ, 異なるマス数が混ざる場合はマス数ごとの残りの個数で部分和を調べる
+    */
+    bool area_reachable(int const area, int const num) const {
+        if(catalog->uniform_size){
+            int const size = catalog->uniform_size;
+            if(area % size != 0) return false;
+            int const need = area / size;
+            return need <= remain_num() && (num < 0 || need == num);
+        }
+
+        // マス数ごとの残りの個数
+        std::vector<std::pair<int, int>> hist;
+        for(int i=0; i<(int)base.size(); ++i){
             if(!unuse[i]) continue;
-            
-            // 各回転・鏡像のパターンを見る
-            for(int j=0; j<(int)pattern[i].size(); ++j){
-                // if(flag_ignore && i == ignore_piece && j > 0) break;
-                // 置けるかどうかをチェック
-                Omino const & shape = pattern[i][j];
-                bool flag_empty = true;
-                for(int k=0; k<(int)shape.size(); ++k){
-                    if(!board.in(place + shape[k]) || board[place + shape[k]] != EMPTY) {
-                        flag_empty = false;
-                        continue;
+            int const size = (int)base[i].size();
+            auto it = std::find_if(hist.begin(), hist.end(), [&](auto const & e){ return e.first == size; });
+            if(it == hist.end()) hist.emplace_back(size, unuse[i]);
+            else it->second += unuse[i];
+        }
+        // reach[j * (area + 1) + v]: j個(個数が任意ならj = 0のみ)で面積vを作れるか
+        int const layer = (num < 0 ? 1 : num + 1);
+        std::vector<char> reach(layer * (area + 1), 0);
+        reach[0] = 1;
+        for(auto const & [size, cnt] : hist){
+            for(int k=0; k<cnt; ++k){
+                for(int j=layer-1; j>=0; --j){
+                    int const from = (num < 0 ? j : j - 1);
+                    if(from < 0) break;
+                    for(int v=area; v>=size; --v){
+                        if(reach[from * (area + 1) + v - size]) reach[j * (area + 1) + v] = 1;
                     }
                 }
-                if(!flag_empty) continue;
+            }
+        }
+        return reach[(layer - 1) * (area + 1) + area];
+    }
 
-                // std::cout << "depth[" << depth << "] use[" << i << "]: place(" << place << ")   " << shape.moved_by(place) << std::endl;
+    /**
+     * @brief solve_subset, list_subsetsの枝刈り, 部分集合で埋められる可能性があればtrue
+     * @param[in] used ここまでに使ったピースの集合(個数)のビット表現
+    */
+    bool subset_feasible(Coord const place, unsigned long long const used, bool const check_split){
+        if(!area_reachable(empty_num, subset_piece_num < 0 ? -1 : subset_piece_num - piece_total(used))) return false;
+        // 全てのピースを使うとは限らないので, 彩色は残りのピースで覆いきれるかのみ調べる
+        if(!pruner.feasible(false, true)) return false;
+        // fillable_cacheの値は部分集合で埋められるかなので, そのまま使える
+        if(check_split && split_areas(place) > 1 && !fillable_areas(true)) return false;
+        if(coverage_active && has_dead_cell()) return false;
+        return true;
+    }
+
+    /**
+     * @brief solve_subsetの本体
+    */
+    template <typename Func>
+    void solve_subset_rec(Coord place, unsigned long long const used, bool const check_split, Func && f){
+        if(subset_stop) return;
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0){
+            ++subset_num;
+            if(!f(static_cast<Board const &>(board), used)) subset_stop = true;
+            return;
+        }
+        ++iterate_num;
+        if(!subset_feasible(place, used, check_split)) return;
+        for_each_fit(place, [&](int const i, int const j){ solve_subset_rec(place, used + (1ULL << piece_shift[i]), flag_bits || may_split(i, j, place), f); });
+    }
+
+    /**
+     * @brief list_subsetsの本体
+    */
+    template <typename Func>
+    void list_subsets_rec(Coord place, unsigned long long const used, bool const check_split, Func && f){
+        if(subset_stop) return;
+        place = board.get_topleft(place, EMPTY);
+        if(place.x < 0){
+            list_subsets_emit(used, f);
+            return;
+        }
+        ++iterate_num;
+        if(!subset_feasible(place, used, check_split)) return;
+
+        // 残りが小さければ最も小さい領域を埋めるピースの集合ごとにまとめて進める
+        // 未使用のピースが必要な面積より十分多いと領域の埋め方の列挙の方が重くなるので, 2倍以下の場合のみ
+        if(flag_decompose && empty_num <= small_area_limit && remain_area() <= 2 * empty_num){
+            int const num = split_areas(place);
+            int smallest = 0;
+            for(int i=1; i<num; ++i){
+                if(area_size(i) < area_size(smallest)) smallest = i;
+            }
+            std::vector<std::pair<unsigned long long, long long int>> tmp;
+            auto const & masks = area_tilings(smallest, tmp);
+            if(num == 1){
+                for(auto const & [mask, n] : masks) list_subsets_emit(used + mask, f);
+                return;
+            }
+            std::vector<Coord> area = get_area(smallest);
+            set_area(area, INVALID);
+            for(auto const & [mask, n] : masks){
+                set_unuse(mask, false);
+                list_subsets_rec(place, used + mask, true, f);
+                set_unuse(mask, true);
+            }
+            set_area(area, EMPTY);
+            return;
+        }
+
+        for_each_fit(place, [&](int const i, int const j){ list_subsets_rec(place, used + (1ULL << piece_shift[i]), flag_bits || may_split(i, j, place), f); });
+    }
+
+    /**
+     * @brief 見つかった部分集合が未列挙でピースの数が合えばfを呼ぶ
+    */
+    template <typename Func>
+    void list_subsets_emit(unsigned long long const used, Func && f){
+        if(subset_stop) return;
+        if(subset_piece_num >= 0 && piece_total(used) != subset_piece_num) return;
+        if(!subset_found.insert(used).second) return;
+        ++subset_num;
+        if(!f(used)) subset_stop = true;
+    }
+
+    /**
+     * @brief feasibleの探索が上限に達したか(時間は1024ノードごとに調べる)
+    */
+    bool search_over(){
+        ++search_node;
+        if(search_node_limit >= 0 && search_node > search_node_limit) search_abort = true;
+        if(search_time_limit >= 0 && (search_node & 1023) == 0){
+            std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - search_start;
+            if(elapsed.count() > search_time_limit) search_abort = true;
+        }
+        return search_abort;
+    }
 
-                // 置ける場合は置いて使用状況をfalseに
-                for(int k=0; k<(int)shape.size(); ++k){
-                    board[place + shape[k]] = i;
+    /**
+     * @brief 空きマスが分断されているとき, 最も小さい領域を使うピースの組み合わせごとに数え, 残りの領域の個数と掛け合わせる
+     * @note split_areasの直後に呼ぶ
+    */
+    long long int count_split(Coord const place){
+        int smallest = 0;
+        for(int i=1; i<area_num(); ++i){
+            if(area_size(i) < area_size(smallest)) smallest = i;
+        }
+        std::vector<Coord> area = get_area(smallest);
+        std::vector<std::pair<unsigned long long, long long int>> tmp;
+        auto const & masks = area_tilings(smallest, tmp);
+
+        long long int res = 0;
+        set_area(area, INVALID);
+        for(auto const & [mask, num] : masks){
+            set_unuse(mask, false);
+            res += num * count_fill(place, true);
+            set_unuse(mask, true);
+        }
+        set_area(area, EMPTY);
+        return res;
+    }
+
+    /**
+     * @brief split_areasの領域idxについてcount_areaの結果を求める
+     * @param[out] tmp キャッシュを使わない場合の結果の置き場所
+     * @return count_areaの結果(tiling_cacheの要素かtmp)
+     * @note 小さな領域は形と残りのピースが同じなら埋め方も同じなのでtiling_cacheを参照・記録する
+    */
+    std::vector<std::pair<unsigned long long, long long int>> const & area_tilings(int const idx, std::vector<std::pair<unsigned long long, long long int>> & tmp){
+        AreaKey key;
+        bool const flag_cache = area_size(idx) <= small_area_limit && area_key(idx, key);
+        if(flag_cache){
+            auto it = tiling_cache.find(key);
+            if(it != tiling_cache.end()){
+                ++cache_hit;
+                return it->second;
+            }
+            ++cache_miss;
+        }
+        tmp = count_area(get_area(idx));
+        if(flag_cache && tiling_cache.size() < fillable_cache_max){
+            fillable_cache.emplace(key, !tmp.empty());
+            return tiling_cache.emplace(key, std::move(tmp)).first->second;
+        }
+        return tmp;
+    }
+
+    /**
+     * @brief 領域のみを埋める方法の個数を, 使用したピースの集合(個数のビット表現)ごとに求める
+     * @param[in] area 領域のマス(探索順にソート済み)
+     * @return (ピースの集合, 個数)の列
+    */
+    std::vector<std::pair<unsigned long long, long long int>> count_area(std::vector<Coord> const & area){
+        std::vector<unsigned long long> tilings;
+        search_area(area, tilings, false);
+
+        // ソートして同じ集合をまとめる
+        std::sort(tilings.begin(), tilings.end());
+        std::vector<std::pair<unsigned long long, long long int>> res;
+        for(auto const mask : tilings){
+            if(res.empty() || res.back().first != mask) res.emplace_back(mask, 0);
+            ++res.back().second;
+        }
+        return res;
+    }
+
+    /**
+     * @brief 領域内に限定して配置を探索する
+     * @param[in] area 領域のマス(探索順にソート済み)
+     * @param[out] tilings 見つかった埋め方ごとの使用したピースの集合
+     * @param[in] first_only 一つ見つかったら終了する
+    */
+    void search_area(std::vector<Coord> const & area, std::vector<unsigned long long> & tilings, bool const first_only){
+        int const saved = active_region;
+        unsigned long long const saved_bits = region_bits;
+        active_region = ++region_stamp;
+        if(flag_bits) region_bits = 0;
+        for(auto const & c : area){
+            region_mark[board.index(c)] = active_region;
+            if(flag_bits) region_bits |= 1ULL << board.index(c);
+        }
+        search_area_rec(area, 0, 0ULL, tilings, first_only);
+        active_region = saved;
+        region_bits = saved_bits;
+    }
+
+    /**
+     * @brief search_areaの本体
+    */
+    void search_area_rec(std::vector<Coord> const & area, int k, unsigned long long const used, std::vector<unsigned long long> & tilings, bool const first_only){
+        if(first_only && !tilings.empty()) return;
+        while(k < (int)area.size() && board[area[k]] != EMPTY) ++k;
+        if(k == (int)area.size()){
+            tilings.push_back(used);
+            return;
+        }
+        ++iterate_num;
+        for_each_fit(area[k], [&](int const i, int){ search_area_rec(area, k+1, used + (1ULL << piece_shift[i]), tilings, first_only); });
+    }
+
+    /**
+     * @brief split_areasの各領域が埋められる可能性があるかを調べる
+     * @note 面積が未使用のピースの面積の和で作れなければ不可, 小さな領域はfillable_cacheを参照
+     * @param[in] search_miss キャッシュにない小さな領域をその場で探索して記録するか
+     * @note countでは最も小さい領域をcount_splitで探索して記録するので, キャッシュの参照のみ行う
+    */
+    bool fillable_areas(bool const search_miss){
+        int const num = area_num();
+        for(int i=0; i<num; ++i){
+            if(!area_reachable(area_size(i), -1)) return false;
+        }
+        if(!flag_decompose) return true;
+        for(int i=0; i<num; ++i){
+            if(area_size(i) > small_area_limit) continue;
+            AreaKey key;
+            if(!area_key(i, key)) continue;
+            auto it = fillable_cache.find(key);
+            if(it != fillable_cache.end()){
+                ++cache_hit;
+                if(!it->second) return false;
+                continue;
+            }
+            if(!search_miss) continue;
+            ++cache_miss;
+            std::vector<unsigned long long> tilings;
+            search_area(get_area(i), tilings, true);
+            bool const fillable = !tilings.empty();
+            if(fillable_cache.size() < fillable_cache_max) fillable_cache.emplace(key, fillable);
+            if(!fillable) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief split_areasの領域idxについてfillable_cacheのキー(領域の正規形, 残りのピース)を作る
+     * @param[out] key 作ったキー
+     * @return 外接長方形が128マスを超えキーを作れない場合はfalse
+     * @note 64マス以下の盤面では平行移動で移り合う領域が, それ以外では回転・鏡像で移り合う領域も同じキーになる
+     * @note 64マスを超える三次元の盤面ではキーを作らない
+    */
+    bool area_key(int const idx, AreaKey & key){
+        key = AreaKey();
+        for(int i=0; i<(int)base.size(); ++i) key.piece |= (unsigned long long)unuse[i] << piece_shift[i];
+
+        if(flag_bits){
+            // 64マス以下の盤面は平行移動のみ正規化し, 領域のビットを左端のx・上端の行の分だけずらす
+            // 三次元の盤面もxの単位(d * h)でずらせばよい, 形の解釈は盤面の高さと奥行きで決まるのでhに入れる
+            int const h = (int)board.h_size;
+            int const slab = (int)board.d_size * h;
+            unsigned long long const bits = area_bits[idx] >> (std::countr_zero(area_bits[idx]) / slab * slab);
+            unsigned long long rows = 0;
+            for(unsigned long long b = bits; b; b >>= h) rows |= b;
+            key.lo = bits >> std::countr_zero(rows);
+            key.h = -(h + 64 * ((int)board.d_size - 1));
+            return true;
+        }
+        if(board.d_size != 1) return false;
+
+        key_cells.assign(area_cells.begin() + area_begin[idx], area_cells.begin() + area_begin[idx+1]);
+        unsigned long long const piece = key.piece;
+
+        bool found = false;
+        for(int t=0; t<8; ++t){
+            // t == 4で鏡像にし, それ以外は時計回りに回転する(回転4通り×鏡像2通り)
+            int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+            for(auto & c : key_cells){
+                if(t == 4) c.x *= -1;
+                else if(t != 0){ std::swap(c.x, c.y); c.y *= -1; }
+                min_x = std::min(min_x, c.x); max_x = std::max(max_x, c.x);
+                min_y = std::min(min_y, c.y); max_y = std::max(max_y, c.y);
+            }
+            int const h = max_y - min_y + 1;
+            if((max_x - min_x + 1) * h > 128) return false;
+            AreaKey tmp;
+            tmp.h = h;
+            for(auto const & c : key_cells){
+                int const bit = (c.x - min_x) * h + (c.y - min_y);
+                if(bit < 64) tmp.lo |= 1ULL << bit;
+                else tmp.hi |= 1ULL << (bit - 64);
+            }
+            if(!found || std::tie(tmp.h, tmp.hi, tmp.lo) < std::tie(key.h, key.hi, key.lo)) key = tmp;
+            found = true;
+        }
+        key.piece = piece;
+        return true;
+    }
+
+    /**
+     * @brief placeに置ける全てのピース・パターンについて, 配置した状態でfを呼ぶ
+     * @param[in] place 配置場所
+     * @param[in] f 配置したピース番号とパターン番号を受け取る関数
+     * @note active_regionが0でなければその領域内のマスにのみ置く
+    */
+    template <typename Func>
+    void for_each_fit(Coord const place, Func && f){
+        int const pos = cell_index(place);
+        unsigned long long const free_bits = empty_bits & region_bits;
+        for(int i=0; i<(int)pattern.size(); ++i){
+            if(!unuse[i]) continue;
+            for(int j=0; j<(int)pattern[i].size(); ++j){
+                auto const & ker = kernel[i][j];
+                Coord const origin = place - ker.anchor;
+                if(flag_bits){
+                    // 64マス以下の盤面はビット演算で判定
+                    Span const & sp = span[i][j];
+                    if(!((sp.anchor >> pos) & 1)) continue;
+                    if((sp.mask << pos) & ~free_bits) continue;
+                }else{
+                    if(!board.in(ker, origin)) continue;
+                    if(!ker.all_of(origin, [&](Coord const & c){ return cell(c) == EMPTY && (!active_region || region_mark[cell_index(c)] == active_region); })) continue;
                 }
-                unuse[i] = false;
 
-                // 深さ+1へ
-                solve(place, depth+1);
+                ker.for_each(origin, [&](Coord const & c){
+                    cell(c) = i;
+                    pruner.fill_cell(c);
+                });
+                --unuse[i];
+                pruner.use_piece(i);
+                empty_num -= (int)ker.cell.size();
+                if(flag_bits) empty_bits ^= span[i][j].mask << pos;
+
+                f(i, j);
 
                 // ボードから取り出す＆使用状況をリセット(重要)
-                for(int k=0; k<(int)shape.size(); ++k){
-                    board[place + shape[k]] = EMPTY;
-                }
-                unuse[i] = true;
+                ker.for_each(origin, [&](Coord const & c){
+                    cell(c) = EMPTY;
+                    pruner.fill_cell(c, -1);
+                });
+                ++unuse[i];
+                pruner.use_piece(i, -1);
+                empty_num += (int)ker.cell.size();
+                if(flag_bits) empty_bits ^= span[i][j].mask << pos;
             }
         }
     }
+
+    /**
+     * @brief マスの値, 二次元のピースでは盤面も二次元なので奥行きの計算を省く
+    */
+    inline int & cell(Coord const & c){
+        if constexpr (Omino::dimension == 2) return board.board[c.x][c.y];
+        else return board[c];
+    }
+
+    /**
+     * @brief マスの番号(Board::index), 二次元のピースでは奥行きの計算を省く
+    */
+    inline int cell_index(Coord const & c) const {
+        if constexpr (Omino::dimension == 2) return c.x * (int)board.h_size + c.y;
+        else return board.index(c);
+    }
+
+    /**
+     * @brief 未使用のピースのどの配置でも覆えないEMPTYなマスがあるか(64マス以下の盤面のみ)
+     * @note 各パターンを置ける位置をビット演算でまとめて求め, 覆えるマスの和集合をとる
+    */
+    bool has_dead_cell(){
+        unsigned long long const free_bits = empty_bits & region_bits;
+        unsigned long long rest = free_bits;
+        // 回転・鏡像の多いピースほど多くのマスを覆うので先に調べる
+        for(auto const i : catalog->coverage_order){
+            if(!unuse[i]) continue;
+            for(auto const & sp : span[i]){
+                unsigned long long fit = sp.anchor;
+                for(int k=0; k<sp.size; ++k) fit &= free_bits >> sp.offset[k];
+                for(int k=0; k<sp.size; ++k) rest &= ~(fit << sp.offset[k]);
+            }
+            if(rest == 0) return false;
+        }
+        ++coverage_cut;
+        return true;
+    }
+
+    /**
+     * @brief 領域のマスを全てvalにする(EMPTY⇔INVALIDの切り替え用)
+    */
+    void set_area(std::vector<Coord> const & area, int const val){
+        int const delta = (val == EMPTY ? -1 : 1);
+        for(auto const & c : area){
+            board[c] = val;
+            pruner.fill_cell(c, delta);
+            if(flag_bits) empty_bits ^= 1ULL << board.index(c);
+        }
+        empty_num -= delta * (int)area.size();
+    }
+
+    /**
+     * @brief maskに含まれるピースを, flagがtrueなら未使用に戻し, falseなら使用済みにする
+     * @param[in] mask ピースの集合(個数)のビット表現
+    */
+    void set_unuse(unsigned long long const mask, bool const flag){
+        for(int i=0; i<(int)base.size(); ++i){
+            int const n = piece_count(mask, i);
+            if(n == 0) continue;
+            unuse[i] += flag ? n : -n;
+            pruner.use_piece(i, flag ? -n : n);
+        }
+    }
 };
 
 
-} // namespace PolyominoPuzzle
\ No newline at end of file
+} // namespace PolyominoPuzzle
@@ -0,0 +1,218 @@
+/**
+ * @brief ピースの形状・回転/鏡像など, 盤面によらない読み取り専用のデータ
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "polyomino.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief ピースの周囲8近傍(三次元では26近傍)のマス, 配置で空きマスが分断されうるかの判定に使う
+*/
+struct PieceHalo{
+    std::vector<Coord> cell;                // 周囲のマス(パターンの(0,0)からの相対位置)
+    std::vector<unsigned long long> adj;    // [周囲のマス] -> 4近傍で隣接する周囲のマス
+    unsigned long long touch{};             // ピースと4近傍で隣接する周囲のマス
+    bool valid{};                           // 周囲のマスが64個以下か
+};
+
+/**
+ * @brief ピースの一覧と, そこから求まる盤面によらないデータ
+ * @note 作った後は変更しないので, 複数のPackingPuzzle・スレッドから共有してよい
+ * @note standard()はomino_sizeの全てのポリオミノ(三次元では鏡像を区別したポリキューブ)の一覧で, プロセス内で一度だけ作られる
+ * @note load()はファイルに書かれた形の一覧から作る(MixedOminoならサイズの異なる形を混ぜられる)
+*/
+template <typename Omino>
+struct PieceCatalog{
+    std::vector<Omino> base;                                    // ベースとなるポリオミノ
+    std::vector<std::vector<Omino>> pattern;                    // baseの回転や鏡像を考えたポリオミノ(左上が(0,0))
+    std::vector<std::vector<typename Omino::Kernel>> kernel;    // patternごとの配置判定・配置用のカーネル
+    std::vector<std::vector<PieceHalo>> halo;                   // [ピース][パターン] -> 周囲のマス
+    std::vector<int> rotationity;                               // 回転で重ならない向きの数(1, 2, 4, 三次元ではxy平面内の回転)
+    std::vector<int> reflectionity;                             // 鏡像で重ならない向きの数(1, 2, 三次元ではx軸の反転)
+    std::vector<int> coverage_order;                            // 回転・鏡像の多い順のピース番号
+    int uniform_size{};                                         // 全てのピースのマス数が同じならそのマス数, 異なれば0
+    int max_size{};                                             // ピースのマス数の最大
+    bool mirror{};                                              // 鏡像の向きも使うか
+
+    /**
+     * @brief ピースの一覧から作る
+     * @param[in] _mirror 鏡像の向きも使うか(既定では二次元は使い, 三次元のポリキューブは回転のみ)
+    */
+    PieceCatalog(std::vector<Omino> const & _base, bool const _mirror = (Omino::dimension == 2)) : base(_base), mirror(_mirror){
+        Omino::pattern_enumeration(pattern, base, mirror);
+        kernel.assign(pattern.size(), {});
+        for(int i=0; i<(int)pattern.size(); ++i){
+            for(auto const & shape : pattern[i]) kernel[i].emplace_back(shape);
+        }
+        for(auto const & p : base){
+            rotationity.push_back(p.rotationity_90() ? 1 : (p.rotationity_180() ? 2 : 4));
+            reflectionity.push_back(p.reflectionity() ? 1 : 2);
+        }
+        coverage_order.resize(pattern.size());
+        for(int i=0; i<(int)pattern.size(); ++i) coverage_order[i] = i;
+        std::stable_sort(coverage_order.begin(), coverage_order.end(), [&](int const a, int const b){ return pattern[a].size() > pattern[b].size(); });
+        uniform_size = (int)base.front().size();
+        for(auto const & p : base){
+            if((int)p.size() != uniform_size) uniform_size = 0;
+            max_size = std::max(max_size, (int)p.size());
+        }
+        init_halo();
+    }
+
+    /**
+     * @brief omino_sizeの全てのポリオミノからなるカタログ(初回の呼び出しで一度だけ列挙する)
+     * @note 関数内のstatic変数の初期化はスレッドセーフ
+    */
+    static std::shared_ptr<PieceCatalog const> const & standard(){
+        static std::shared_ptr<PieceCatalog const> const instance = [](){
+            std::vector<Omino> b;
+            Omino::enumeration(b);
+            return std::make_shared<PieceCatalog const>(b);
+        }();
+        return instance;
+    }
+
+    /**
+     * @brief 形の一覧のファイルからカタログを作る
+     * @param[in] path ファイルのパス, #がピースのマス, .が空白の行からなり, 形同士は空行で区切る(盤面のファイルと同じ形式)
+     *                 ポリキューブでは-だけの行でz方向の層を区切る
+     * @param[out] inventory [ピース] -> 個数, 回転・鏡像で同じ形が複数あれば1種類にまとめて個数を数える
+     * @param[out] error 読み込めなかった理由
+     * @return 読み込めなければnullptr
+     * @note 各形は4近傍で連結であること, Ominoのマス数が固定ならそのマス数であること
+    */
+    static std::shared_ptr<PieceCatalog const> load(std::string const & path, std::vector<int> & inventory, std::string & error){
+        std::ifstream ifs(path);
+        if(!ifs){
+            error = "cannot open " + path;
+            return nullptr;
+        }
+        std::vector<Omino> shapes;
+        inventory.clear();
+        std::vector<std::string> lines;
+        std::string line;
+        bool flag_eof = false;
+        while(!flag_eof){
+            flag_eof = !std::getline(ifs, line);
+            if(!flag_eof && !line.empty() && line.back() == '\r') line.pop_back();
+            if(!flag_eof && !line.empty()){
+                lines.push_back(line);
+                continue;
+            }
+            if(lines.empty()) continue;
+
+            // 1つの形を読み込む
+            std::vector<Coord> cell;
+            for(int k=0, y=0, z=0; k<(int)lines.size(); ++k, ++y){
+                if(lines[k].find_first_not_of('-') == std::string::npos){
+                    if(Omino::dimension != 3){
+                        error = "layer separator in shape " + std::to_string(shapes.size()) + " (only for polycubes)";
+                        return nullptr;
+                    }
+                    ++z;
+                    y = -1;
+                    continue;
+                }
+                for(int x=0; x<(int)lines[k].size(); ++x){
+                    if(lines[k][x] == '#') cell.push_back({x, y, z});
+                    else if(lines[k][x] != '.'){
+                        error = "unexpected character in shape " + std::to_string(shapes.size()) + " (only '.' and '#' are allowed)";
+                        return nullptr;
+                    }
+                }
+            }
+            lines.clear();
+            if(cell.empty() || (Omino().size() != 0 && cell.size() != Omino().size())){
+                error = "shape " + std::to_string(shapes.size()) + " has " + std::to_string(cell.size()) + " cells";
+                return nullptr;
+            }
+            if(!connected(cell)){
+                error = "shape " + std::to_string(shapes.size()) + " is not connected";
+                return nullptr;
+            }
+            Omino p;
+            p.elem = cell;
+            auto it = std::find_if(shapes.begin(), shapes.end(), [&](Omino const & q){ return q.size() == p.size() && q.is_same(p); });
+            if(it != shapes.end()){
+                ++inventory[it - shapes.begin()];
+                continue;
+            }
+            shapes.push_back(p);
+            inventory.push_back(1);
+        }
+        if(shapes.empty()){
+            error = "no shapes in " + path;
+            return nullptr;
+        }
+        return std::make_shared<PieceCatalog const>(shapes);
+    }
+
+private:
+    /**
+     * @brief マスが4近傍(三次元では6近傍)で連結か
+    */
+    static bool connected(std::vector<Coord> const & cell){
+        std::vector<Coord> reach = {cell.front()};
+        for(int k=0; k<(int)reach.size(); ++k){
+            for(auto const & c : cell){
+                int const d = std::abs(c.x - reach[k].x) + std::abs(c.y - reach[k].y) + std::abs(c.z - reach[k].z);
+                if(d == 1 && std::find(reach.begin(), reach.end(), c) == reach.end()) reach.push_back(c);
+            }
+        }
+        return reach.size() == cell.size();
+    }
+
+    /**
+     * @brief 各パターンの周囲のマスを求める
+    */
+    void init_halo(){
+        Coord const near[6] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}, {0, 0, 1}, {0, 0, -1}};
+        int const near_num = (Omino::dimension == 3 ? 6 : 4);
+        int const dz_max = (Omino::dimension == 3 ? 1 : 0);
+        halo.assign(pattern.size(), {});
+        for(int i=0; i<(int)pattern.size(); ++i){
+            for(auto const & shape : pattern[i]){
+                PieceHalo h;
+                auto inside = [&](Coord const & c){
+                    for(int k=0; k<(int)shape.size(); ++k) if(shape[k] == c) return true;
+                    return false;
+                };
+                for(int k=0; k<(int)shape.size(); ++k){
+                    for(int dx=-1; dx<=1; ++dx){
+                        for(int dy=-1; dy<=1; ++dy){
+                            for(int dz=-dz_max; dz<=dz_max; ++dz){
+                                Coord c = shape[k] + Coord{dx, dy, dz};
+                                if(inside(c) || std::find(h.cell.begin(), h.cell.end(), c) != h.cell.end()) continue;
+                                h.cell.push_back(c);
+                            }
+                        }
+                    }
+                }
+                h.valid = (h.cell.size() <= 64);
+                if(h.valid){
+                    h.adj.assign(h.cell.size(), 0);
+                    for(int a=0; a<(int)h.cell.size(); ++a){
+                        for(int l=0; l<near_num; ++l){
+                            Coord c = h.cell[a] + near[l];
+                            if(inside(c)) h.touch |= 1ULL << a;
+                            auto it = std::find(h.cell.begin(), h.cell.end(), c);
+                            if(it != h.cell.end()) h.adj[a] |= 1ULL << (it - h.cell.begin());
+                        }
+                    }
+                }
+                halo[i].emplace_back(std::move(h));
+            }
+        }
+    }
+};
+
+} // namespace PolyominoPuzzle
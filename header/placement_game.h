@@ -0,0 +1,304 @@
+/**
+ * @brief 交互にピースを置き, 置けなくなった方が負けの対戦(Golombのペントミノゲーム)の思考ルーチン
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "polyomino.h"
+#include "piece_catalog.h"
+#include "zobrist.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 反復深化のαβ探索で次の一手を選ぶ
+ * @note 両者は同じピースの集合から選んで置く(置いたピースはどちらのものでもなくなる)
+ * @note 64マス以下の二次元の盤面のみ, 全ての配置を空の盤面でのビット表現として最初に列挙し, 合法手は埋まったマスとのANDで求める
+ * @note 置換表のキーは設定した局面から置いたピースの集合のZobristハッシュ(評価値は手番側から見た値なので手番は含めない)
+ * @note 勝敗の決まらない局面の評価は手番側の合法手の数
+*/
+template <typename Omino>
+struct PlacementGameAI{
+    /**
+     * @brief 手(ピースの配置)
+    */
+    struct Move{
+        int piece = -1;                 // ピース番号(負なら手がない)
+        int pattern{};                  // 回転・鏡像のパターン番号
+        Coord pos;                      // 配置場所(aabbの左上, Board::put_pieceと同じ)
+        unsigned long long mask{};      // 覆うマスのビット表現
+    };
+
+    /**
+     * @brief 探索の結果
+    */
+    struct Result{
+        Move move;                      // 選んだ手
+        int value{};                    // 手番側から見た評価値(勝ちならwin_valueに近い正の値)
+        int depth{};                    // 最後まで探索できた深さ
+        long long int nodes{};          // 探索したノード数
+        bool proven{};                  // 勝敗が読み切れたか
+        double time_ms{};               // かかった時間[ms]
+    };
+
+    static constexpr int win_value = 1000000;   // 勝ちの評価値(早く勝つほど大きい)
+
+    double time_limit = 1000;           // 1手あたりの思考時間の上限[ms]
+    int max_depth = 64;                 // 反復深化の最大の深さ
+    size_t table_size = 1 << 20;        // 置換表のエントリ数(2の冪)
+
+    PlacementGameAI(std::shared_ptr<PieceCatalog<Omino> const> _catalog = PieceCatalog<Omino>::standard()) : catalog(std::move(_catalog)){}
+
+    /**
+     * @brief 局面を設定する
+     * @param[in] board 盤面(EMPTY以外のマスには置けない)
+     * @param[in] _unuse 各ピースの残りの個数
+     * @return 64マスを超える盤面など扱えなければfalse
+     * @note 盤面のサイズが変わった場合のみ配置の一覧と置換表を作り直す
+    */
+    bool set_position(Board const & board, std::vector<int> const & _unuse){
+        if(Omino::dimension != 2 || board.cell_num() > 64) return false;
+        if(move_table.empty() || w_size != board.w_size || h_size != board.h_size) init_table(board.w_size, board.h_size);
+        occupied = 0;
+        for(int k=0; k<board.cell_num(); ++k){
+            if(board[board.coord(k)] != EMPTY) occupied |= 1ULL << k;
+        }
+        unuse = _unuse;
+        // 置換表のキーはここから置いたピースの集合のハッシュなので, 基準値を設定した局面(埋まったマスと残りのピース)から作る
+        unsigned long long base = occupied;
+        for(auto const u : unuse) base = base * 0x9E3779B97F4A7C15ULL + (unsigned long long)u;
+        zobrist.value = base ^ (base >> 29);
+        return true;
+    }
+
+    /**
+     * @brief 現在の局面の合法手
+    */
+    std::vector<Move> legal_moves() const {
+        std::vector<Move> res;
+        for(int i=0; i<(int)move_table.size(); ++i){
+            if(unuse[i] <= 0) continue;
+            for(auto const & m : move_table[i]){
+                if(!(m.mask & occupied)) res.push_back(m);
+            }
+        }
+        return res;
+    }
+
+    /**
+     * @brief 時間の上限まで反復深化で探索し, 最後に探索しきった深さの最善手を返す
+     * @note 合法手がなければmove.pieceが負(手番側の負け)
+    */
+    Result think(){
+        start = std::chrono::steady_clock::now();
+        abort = false;
+        nodes = 0;
+        if(table.size() != table_size) table.assign(table_size, {});
+        Result res;
+        std::vector<std::pair<int, int>> root;
+        gen_moves(root);
+        if(root.empty()){
+            res.value = -win_value;
+            res.proven = true;
+            return res;
+        }
+        res.move = move_table[root.front().first][root.front().second];
+        int remain = 0;
+        for(auto const u : unuse) remain += std::max(u, 0);
+
+        for(int depth=1; depth<=max_depth; ++depth){
+            int alpha = -INT_MAX, best = -1;
+            for(int k=0; k<(int)root.size(); ++k){
+                play(root[k], true);
+                int const v = -negamax(depth - 1, -INT_MAX, -alpha, 1);
+                play(root[k], false);
+                if(abort) break;
+                if(v > alpha){
+                    alpha = v;
+                    best = k;
+                }
+            }
+            if(abort) break;
+            // 最善手を次の深さで最初に調べる
+            std::rotate(root.begin(), root.begin() + best, root.begin() + best + 1);
+            res.move = move_table[root.front().first][root.front().second];
+            res.value = alpha;
+            res.depth = depth;
+            res.proven = (std::abs(alpha) >= win_value - 1000 || depth >= remain);
+            if(res.proven) break;
+        }
+        res.nodes = nodes;
+        res.time_ms = elapsed_ms();
+        return res;
+    }
+
+private:
+    /**
+     * @brief 置換表のエントリ
+    */
+    struct Entry{
+        unsigned long long key{};
+        int value{};
+        int depth = -1;                 // 負なら空き
+        int bound{};                    // 0: 正確な値, 1: 下限, 2: 上限
+        int piece = -1, index{};        // 最善手(move_tableの位置)
+    };
+
+    std::shared_ptr<PieceCatalog<Omino> const> catalog;
+    std::vector<std::vector<Move>> move_table;  // [ピース] -> 空の盤面での全ての配置
+    size_t w_size{}, h_size{};
+    unsigned long long occupied{};              // 埋まったマス
+    std::vector<int> unuse;                     // 各ピースの残りの個数
+    ZobristHash zobrist;
+    std::vector<Entry> table;                   // 置換表(ハッシュ値の下位ビットの位置に上書き)
+    std::vector<std::vector<std::pair<int, int>>> move_buffer;  // [ルートからの深さ] -> 合法手
+    std::chrono::steady_clock::time_point start;
+    long long int nodes{};
+    bool abort{};
+
+    /**
+     * @brief 盤面のサイズに対する全ての配置とZobristの乱数表を作る
+    */
+    void init_table(size_t const w, size_t const h){
+        w_size = w;
+        h_size = h;
+        Board empty(w, h, EMPTY);
+        auto const & kernel = catalog->kernel;
+        move_table.assign(kernel.size(), {});
+        for(int i=0; i<(int)kernel.size(); ++i){
+            for(int j=0; j<(int)kernel[i].size(); ++j){
+                for(int x=0; x<(int)w; ++x){
+                    for(int y=0; y<(int)h; ++y){
+                        if(!empty.putable(kernel[i][j], {x, y})) continue;
+                        Move m{i, j, {x, y}, 0};
+                        kernel[i][j].for_each({x, y}, [&](Coord const & c){ m.mask |= 1ULL << empty.index(c); });
+                        move_table[i].push_back(m);
+                    }
+                }
+            }
+        }
+        zobrist.init(catalog->pattern, w, h);
+        table.clear();
+    }
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief 合法手を(ピース, move_tableの位置)で列挙する
+    */
+    void gen_moves(std::vector<std::pair<int, int>> & res) const {
+        res.clear();
+        for(int i=0; i<(int)move_table.size(); ++i){
+            if(unuse[i] <= 0) continue;
+            for(int k=0; k<(int)move_table[i].size(); ++k){
+                if(!(move_table[i][k].mask & occupied)) res.emplace_back(i, k);
+            }
+        }
+    }
+
+    /**
+     * @brief 合法手の数
+    */
+    int count_moves() const {
+        int res = 0;
+        for(int i=0; i<(int)move_table.size(); ++i){
+            if(unuse[i] <= 0) continue;
+            for(auto const & m : move_table[i]) res += !(m.mask & occupied);
+        }
+        return res;
+    }
+
+    /**
+     * @brief 手を置く(flagがfalseなら取り除く)
+    */
+    void play(std::pair<int, int> const & mv, bool const flag){
+        Move const & m = move_table[mv.first][mv.second];
+        occupied ^= m.mask;
+        unuse[m.piece] += flag ? -1 : 1;
+        zobrist.toggle(m.piece, m.pattern, m.pos);
+    }
+
+    /**
+     * @brief 手番側から見た評価値(ネガマックス)
+     * @param[in] ply ルートからの深さ(早く勝つ手を選ぶため勝ちの値から引く)
+    */
+    int negamax(int const depth, int alpha, int beta, int const ply){
+        ++nodes;
+        if((nodes & 1023) == 0 && time_limit >= 0 && elapsed_ms() > time_limit) abort = true;
+        if(abort) return 0;
+
+        Entry & e = table[zobrist.value & (table.size() - 1)];
+        std::pair<int, int> hint(-1, 0);
+        if(e.depth >= 0 && e.key == zobrist.value){
+            hint = {e.piece, e.index};
+            if(e.depth >= depth){
+                int const v = from_table(e.value, ply);
+                if(e.bound == 0 || (e.bound == 1 && v >= beta) || (e.bound == 2 && v <= alpha)) return v;
+            }
+        }
+
+        if(depth == 0){
+            int const num = count_moves();
+            return num == 0 ? -(win_value - ply) : num;
+        }
+        // 手の一覧は深さごとのバッファを使い回す
+        if((int)move_buffer.size() <= ply) move_buffer.resize(ply + 1);
+        auto & moves = move_buffer[ply];
+        gen_moves(moves);
+        if(moves.empty()) return -(win_value - ply);
+        if(hint.first >= 0){
+            auto it = std::find(moves.begin(), moves.end(), hint);
+            if(it != moves.end()) std::iter_swap(moves.begin(), it);
+        }
+
+        int const alpha0 = alpha;
+        int best = -INT_MAX;
+        std::pair<int, int> best_move = moves.front();
+        for(auto const & mv : moves){
+            play(mv, true);
+            int const v = -negamax(depth - 1, -beta, -alpha, ply + 1);
+            play(mv, false);
+            if(abort) return 0;
+            if(v > best){
+                best = v;
+                best_move = mv;
+            }
+            alpha = std::max(alpha, v);
+            if(alpha >= beta) break;
+        }
+
+        Entry & w = table[zobrist.value & (table.size() - 1)];
+        w.key = zobrist.value;
+        w.value = to_table(best, ply);
+        w.depth = depth;
+        w.bound = (best <= alpha0 ? 2 : best >= beta ? 1 : 0);
+        w.piece = best_move.first;
+        w.index = best_move.second;
+        return best;
+    }
+
+    /**
+     * @brief 勝敗の値をルートからの深さによらない値にして置換表に入れる
+    */
+    static int to_table(int const v, int const ply){
+        if(v >= win_value - 1000) return v + ply;
+        if(v <= -(win_value - 1000)) return v - ply;
+        return v;
+    }
+
+    static int from_table(int const v, int const ply){
+        if(v >= win_value - 1000) return v - ply;
+        if(v <= -(win_value - 1000)) return v + ply;
+        return v;
+    }
+};
+
+} // namespace PolyominoPuzzle
@@ -8,28 +8,36 @@
 #include <map>
 #include <queue>
 #include <utility>
+#include <algorithm>
+// POLYOMINO_HEADLESSを定義するとコンソール描画用のヘッダを読み込まない(print_colorが使えなくなる)
+#ifndef POLYOMINO_HEADLESS
 #include "console_color.h"
+#endif
 
 namespace PolyominoPuzzle{
 
+#ifndef POLYOMINO_HEADLESS
 using namespace ConsoleOutput;
+#endif
 
 const static int EMPTY   = -1; // 盤面に何もない状態を表す数値
 const static int HOLE    = -2; // 盤面上で置くことができない状態を表す数値、EMPTYにもならない
 const static int INVALID = -3; // 盤面上で無効な値、探索などに使用
 
 /**
- * @brief 二次元整数座標
+ * @brief 整数座標(二次元ではzは常に0)
+ * @note 大小比較はx, z, yの順で, 盤面のマスの番号(Board::index)の順と一致する
 */
 struct Coord{
     int x;
     int y;
+    int z = 0;                              // 奥行き(三次元の盤面・ポリキューブのみ)
 
     // Coord(int const _x = 0, int const _y = 0) : x(_x), y(_y){}
     // Coord(std::initializer_list<int> const & list) : x(*(list.begin())), y(*(list.end())){}
 
     bool operator == (Coord const & rhs) const {
-        return x == rhs.x && y == rhs.y;
+        return x == rhs.x && y == rhs.y && z == rhs.z;
     }
 
     bool operator != (Coord const & rhs) const {
@@ -39,6 +47,7 @@ struct Coord{
     Coord & operator = (Coord const & rhs){
         x = rhs.x;
         y = rhs.y;
+        z = rhs.z;
         return *this;
     }
 
@@ -46,6 +55,7 @@ struct Coord{
         Coord res = *this;
         res.x *= -1;
         res.y *= -1;
+        res.z *= -1;
         return res;
     }
 
@@ -58,6 +68,7 @@ struct Coord{
     Coord & operator += (Coord const & rhs){
         x += rhs.x;
         y += rhs.y;
+        z += rhs.z;
         return *this;
     }
 
@@ -70,19 +81,22 @@ struct Coord{
     Coord & operator -= (Coord const & rhs){
         x -= rhs.x;
         y -= rhs.y;
+        z -= rhs.z;
         return *this;
     }
 
     bool operator < (Coord const & rhs) const {
-        return x == rhs.x ? (y < rhs.y) : (x < rhs.x);
+        if(x != rhs.x) return x < rhs.x;
+        return z == rhs.z ? (y < rhs.y) : (z < rhs.z);
     }
 
     bool operator > (Coord const & rhs) const {
-        return x == rhs.x ? (y > rhs.y) : (x > rhs.x);
+        return rhs < *this;
     }
 
     friend std::ostream & operator << (std::ostream & output, Coord const & rhs){
         output << rhs.x << " " << rhs.y;
+        if(rhs.z != 0) output << " " << rhs.z;
         return output;
     }
 
@@ -101,7 +115,7 @@ struct Coord{
      * @param[in] c 移動量
     */
     void move_by(Coord const & c){
-        move_by(c.x, c.y);
+        *this += c;
     }
 
     /**
@@ -121,19 +135,99 @@ struct Coord{
      * @param[in] c 移動量
     */
     Coord moved_by(Coord const & c) const {
-        Coord res = moved_by(c.x, c.y);
+        Coord res = *this + c;
         return res;
     }
 };
 
 
+/**
+ * @brief マス数をコンパイル時に固定した配置判定・配置用のカーネル
+ * @note マスはaabbの左上を(0,0)とした座標で事前に持つので, 呼び出しごとのaabbの計算がない
+ * @note 各マスへの処理はomino_size回に展開される
+*/
+template <size_t omino_size>
+struct PlacementKernel{
+    std::array<Coord, omino_size> cell{};   // aabbの左上からの相対座標
+    Coord anchor{};                         // 左上のマス(get_topleft_pos)のaabbの左上からの相対座標
+    Coord extent{};                         // aabbの大きさ-1
+
+    PlacementKernel() = default;
+
+    template <typename OminoType>
+    PlacementKernel(OminoType const & omino){
+        auto [_min, _max] = omino.get_aabb();
+        for(int k=0; k<(int)omino_size; ++k) cell[k] = omino[k] - _min;
+        anchor = omino[omino.get_topleft_pos()] - _min;
+        extent = _max - _min;
+    }
+
+    /**
+     * @brief aabbの左上をoriginに置いたときの全てのマスについてfが真か
+    */
+    template <typename Func>
+    inline bool all_of(Coord const origin, Func && f) const {
+        return [&]<size_t... k>(std::index_sequence<k...>){
+            return (f(origin + cell[k]) && ...);
+        }(std::make_index_sequence<omino_size>{});
+    }
+
+    /**
+     * @brief aabbの左上をoriginに置いたときの全てのマスについてfを呼ぶ
+    */
+    template <typename Func>
+    inline void for_each(Coord const origin, Func && f) const {
+        [&]<size_t... k>(std::index_sequence<k...>){
+            (f(origin + cell[k]), ...);
+        }(std::make_index_sequence<omino_size>{});
+    }
+};
+
+
+/**
+ * @brief マス数を実行時に決める配置判定・配置用のカーネル(Polyomino<0>用)
+ * @note サイズの異なるピースを混ぜる場合に使う, 各マスへの処理はループになる
+*/
+template <>
+struct PlacementKernel<0>{
+    std::vector<Coord> cell;                // aabbの左上からの相対座標
+    Coord anchor{};                         // 左上のマス(get_topleft_pos)のaabbの左上からの相対座標
+    Coord extent{};                         // aabbの大きさ-1
+
+    PlacementKernel() = default;
+
+    template <typename OminoType>
+    PlacementKernel(OminoType const & omino){
+        auto [_min, _max] = omino.get_aabb();
+        for(int k=0; k<(int)omino.size(); ++k) cell.push_back(omino[k] - _min);
+        anchor = omino[omino.get_topleft_pos()] - _min;
+        extent = _max - _min;
+    }
+
+    template <typename Func>
+    inline bool all_of(Coord const origin, Func && f) const {
+        for(auto const & c : cell){
+            if(!f(origin + c)) return false;
+        }
+        return true;
+    }
+
+    template <typename Func>
+    inline void for_each(Coord const origin, Func && f) const {
+        for(auto const & c : cell) f(origin + c);
+    }
+};
+
 
 /**
  * @brief 盤面、右がx軸正、**下がy軸正**
+ * @note 三次元の盤面(box)は奥がz軸正で, boardには(x, z)の列をx * d_size + zの順に並べる
+ * @note 描画・文字列との変換などは二次元の盤面のみ
 */
 struct Board{
     std::vector<std::vector<int>> board;
     size_t w_size, h_size;
+    size_t d_size = 1;                      // 奥行き(二次元の盤面は1)
 
     Board(size_t const _w = 0, size_t const _h = 0, int const _init = EMPTY) : board(_w, std::vector<int>(_h, _init)), w_size(_w), h_size(_h){}
     Board(std::vector<std::string> const & b) : board(b.front().size(), std::vector<int>(b.size())), w_size(b.front().size()), h_size(b.size()){
@@ -141,6 +235,42 @@ struct Board{
         string_to_board(b);
     }
 
+    /**
+     * @brief 三次元の直方体の盤面を作る
+     * @param[in] _w 幅(x)
+     * @param[in] _h 高さ(y)
+     * @param[in] _d 奥行き(z)
+    */
+    static Board box(size_t const _w, size_t const _h, size_t const _d, int const _init = EMPTY){
+        Board res(_w * _d, _h, _init);
+        res.w_size = _w;
+        res.d_size = _d;
+        return res;
+    }
+
+    /**
+     * @brief マスの数
+    */
+    int cell_num() const {
+        return (int)(w_size * h_size * d_size);
+    }
+
+    /**
+     * @brief マスの番号(列優先, (x * d_size + z) * h_size + y), 左上から右下への探索順と一致する
+     * @note 線形なので, 座標の差を渡せば番号の差になる
+    */
+    inline int index(Coord const & c) const {
+        return (c.x * (int)d_size + c.z) * (int)h_size + c.y;
+    }
+
+    /**
+     * @brief マスの番号から座標を求める(indexの逆)
+    */
+    inline Coord coord(int const idx) const {
+        int const col = idx / (int)h_size;
+        return {col / (int)d_size, idx % (int)h_size, col % (int)d_size};
+    }
+
     /**
      * @brief 左下から右上にかけて探索し、検索対象の値があるかどうか調べる 無かったら-1, -1
      * @param[in] pos 探索を開始する位置
@@ -164,12 +294,15 @@ struct Board{
      * @param[in] n 調べる対象となる値
     */
     Coord get_topleft(Coord pos, int const n){
-        while(pos.x < (int)w_size){
-            // std::cout << "[探索中]:(" << pos << ") : " << board[pos.x][pos.y] << " == " << n << std::endl;
-            if(board[pos.x][pos.y] == n) return pos;
+        // 三次元の盤面では(x, z)の列を順に調べる
+        int const d = (int)d_size;
+        int col = pos.x * d + pos.z;
+        while(col < (int)board.size()){
+            // std::cout << "[探索中]:(" << pos << ") : " << board[col][pos.y] << " == " << n << std::endl;
+            if(board[col][pos.y] == n) return d == 1 ? Coord{col, pos.y} : Coord{col / d, pos.y, col % d};
             ++pos.y;
             if(pos.y >= (int)h_size){
-                ++pos.x;
+                ++col;
                 pos.y = 0;
             }
         }
@@ -180,9 +313,9 @@ struct Board{
      * @brief HOLE以外の全てのマスをある値で埋める
     */
     void fill(int const val){
-        for(int i=0; i<(int)w_size; ++i){
-            for(int j=0; j<(int)h_size; ++j){
-                if(board[i][j] != HOLE) board[i][j] = val;
+        for(auto & col : board){
+            for(auto & v : col){
+                if(v != HOLE) v = val;
             }
         }
     }
@@ -191,7 +324,7 @@ struct Board{
      * @brief 盤面に収まる座標かをチェック
     */
     inline bool in(Coord const & c) const {
-        return c.x >= 0 && c.x < (int)w_size && c.y >= 0 && c.y < (int)h_size;
+        return c.x >= 0 && c.x < (int)w_size && c.y >= 0 && c.y < (int)h_size && c.z >= 0 && c.z < (int)d_size;
     }
 
     /**
@@ -219,7 +352,7 @@ struct Board{
         Coord base = omino.get_aabb_min_pos();
         for(int i=0; i<(int)omino.elem.size(); ++i){
             Coord c = coord + omino.elem[i] - base;
-            if(!in(c) || board[c.x][c.y] != EMPTY) return false;
+            if(!in(c) || operator[](c) != EMPTY) return false;
         }
         return true;
     }
@@ -235,18 +368,49 @@ struct Board{
         Coord base = omino.get_aabb_min_pos();
         for(int i=0; i<(int)omino.elem.size(); ++i){
             Coord c = coord + omino.elem[i] - base;
-            board[c.x][c.y] = val;
+            operator[](c) = val;
         }
     }
 
+    /**
+     * @brief ポリオミノが盤面に収まるかチェック(カーネル版, aabbの範囲のみ調べる)
+     * @param[in] kernel ポリオミノのカーネル
+     * @param[in] coord 配置場所(aabbの左上)
+    */
+    template <size_t omino_size>
+    bool in(PlacementKernel<omino_size> const & kernel, Coord const coord) const {
+        return coord.x >= 0 && coord.y >= 0 && coord.z >= 0 && coord.x + kernel.extent.x < (int)w_size && coord.y + kernel.extent.y < (int)h_size && coord.z + kernel.extent.z < (int)d_size;
+    }
+
+    /**
+     * @brief ポリオミノが置けるかどうかをチェック(カーネル版)
+     * @param[in] kernel ポリオミノのカーネル
+     * @param[in] coord 配置場所(aabbの左上)
+    */
+    template <size_t omino_size>
+    bool putable(PlacementKernel<omino_size> const & kernel, Coord const coord) const {
+        return in(kernel, coord) && kernel.all_of(coord, [&](Coord const & c){ return operator[](c) == EMPTY; });
+    }
+
+    /**
+     * @brief ポリオミノを配置、判定は含まない(カーネル版)
+     * @param[in] kernel ポリオミノのカーネル
+     * @param[in] coord 配置場所(aabbの左上)
+     * @param[in] val ポリオミノのid
+    */
+    template <size_t omino_size>
+    void put_piece(PlacementKernel<omino_size> const & kernel, Coord const coord, int const val){
+        kernel.for_each(coord, [&](Coord const & c){ operator[](c) = val; });
+    }
+
     /**
      * @brief 指定したポリオミノを取り除きEMPTYにする
      * @param[in] id 取り除くポリオミノのid
     */
     void remove_piece(int const id){
-        for(int i=0; i<(int)w_size; ++i){
-            for(int j=0; j<(int)h_size; ++j){
-                if(board[i][j] == id) board[i][j] = EMPTY;
+        for(auto & col : board){
+            for(auto & v : col){
+                if(v == id) v = EMPTY;
             }
         }
     }
@@ -256,7 +420,7 @@ struct Board{
      * @param[in] b 文字列の配列
     */
     void string_to_board(std::vector<std::string> const & b){
-        w_size = b.front().size(), h_size = b.size();
+        w_size = b.front().size(), h_size = b.size(), d_size = 1;
         board.resize(w_size, std::vector<int>(h_size));
 
         for(int i=0; i<(int)w_size; ++i){
@@ -301,6 +465,35 @@ struct Board{
         return res;
     }
 
+    /**
+     * @brief EMPTYなマスを連結成分ごとに分ける
+     * @return 各連結成分のマスの座標, 成分は左上から右下への探索順(get_topleftと同じ順)に並ぶ
+    */
+    std::vector<std::vector<Coord>> split_empty_area() const {
+        std::vector<std::vector<Coord>> res;
+        std::vector<std::vector<char>> visited(w_size, std::vector<char>(h_size, false));
+        Coord const near[4] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+        for(int i=0; i<(int)w_size; ++i){
+            for(int j=0; j<(int)h_size; ++j){
+                if(visited[i][j] || board[i][j] != EMPTY) continue;
+                // 幅優先探索で連結成分を集める(resの末尾をキューとして使う)
+                res.emplace_back();
+                std::vector<Coord> & area = res.back();
+                area.push_back({i, j});
+                visited[i][j] = true;
+                for(int k=0; k<(int)area.size(); ++k){
+                    for(int l=0; l<4; ++l){
+                        Coord c = area[k] + near[l];
+                        if(!in(c) || visited[c.x][c.y] || board[c.x][c.y] != EMPTY) continue;
+                        visited[c.x][c.y] = true;
+                        area.push_back(c);
+                    }
+                }
+            }
+        }
+        return res;
+    }
+
     /**
      * @brief 与えられたマスが孤立したスペースかどうかを計算
      * @param[in] p 座標
@@ -320,8 +513,8 @@ struct Board{
      * @brief ボード同士が等しいかどうかを計算
     */
     bool is_same(Board const & b) const {
-        if(w_size != b.w_size || h_size != b.h_size) return false;
-        for(int i=0; i<(int)w_size; ++i){
+        if(w_size != b.w_size || h_size != b.h_size || d_size != b.d_size) return false;
+        for(int i=0; i<(int)board.size(); ++i){
             for(int j=0; j<(int)h_size; ++j){
                 if(board[i][j] != b[i][j]) return false;
             }
@@ -450,30 +643,34 @@ struct Board{
     }
 
     int & operator [] (Coord const & rhs){
-        return board[rhs.x][rhs.y];
+        return board[rhs.x * d_size + rhs.z][rhs.y];
     }
 
     int const operator [] (Coord const & rhs) const {
-        return board[rhs.x][rhs.y];
+        return board[rhs.x * d_size + rhs.z][rhs.y];
     }
 
     int & at(Coord const & rhs){
         assert(in(rhs));
-        return board[rhs.x][rhs.y];
+        return operator[](rhs);
     }
 
     int const & at(Coord const & rhs) const {
         assert(in(rhs));
-        return board[rhs.x][rhs.y];
+        return board[rhs.x * d_size + rhs.z][rhs.y];
     }
 };
 
 
 /**
  * @brief ポリオミノを表現するクラス
+ * @note omino_sizeが0の場合はマス数を実行時に決める(elemの要素数がマス数, enumerationは使えない)
+ * @note omino_dimが3の場合はポリキューブ(各マスのzも使う), 回転は24通りで鏡像は別の形として扱う
 */
-template <size_t omino_size>
+template <size_t omino_size, size_t omino_dim = 2>
 struct Polyomino{
+    using Kernel = PlacementKernel<omino_size>;
+    static constexpr size_t dimension = omino_dim;
     std::vector<Coord> elem;
 
     Polyomino() : elem(omino_size){}
@@ -503,7 +700,7 @@ struct Polyomino{
      * @brief オミノの数を返す
     */
     size_t size() const {
-        return omino_size;
+        return omino_size ? omino_size : elem.size();
     }
 
     /**
@@ -511,7 +708,7 @@ struct Polyomino{
     */
     int get_bottomleft_pos() const {
         int res = 0;
-        for(int i=1; i<(int)omino_size; ++i){
+        for(int i=1; i<(int)size(); ++i){
             if(elem[i].x == elem[res].x ? (elem[i].y > elem[res].y) : (elem[i].x < elem[res].x)) res = i;
         }
         return res;
@@ -522,7 +719,7 @@ struct Polyomino{
     */
     int get_topleft_pos() const {
         int res = 0;
-        for(int i=1; i<(int)omino_size; ++i){
+        for(int i=1; i<(int)size(); ++i){
             if(elem[i] < elem[res]) res = i;
             // if(elem[i].x == elem[res].x ? (elem[i].y > elem[res].y) : (elem[i].x < elem[res].x)) res = i;
         }
@@ -534,9 +731,10 @@ struct Polyomino{
     */
     Coord get_aabb_min_pos() const {
         Coord _min=elem[0];
-        for(int i=1; i<(int)omino_size; ++i){
+        for(int i=1; i<(int)size(); ++i){
             if(elem[i].x < _min.x) _min.x = elem[i].x;
             if(elem[i].y < _min.y) _min.y = elem[i].y;
+            if(elem[i].z < _min.z) _min.z = elem[i].z;
         }
         return _min;
     }
@@ -546,25 +744,29 @@ struct Polyomino{
     */
     std::pair<Coord, Coord> get_aabb() const {
         Coord _min=elem[0], _max=elem[0];
-        for(int i=1; i<(int)omino_size; ++i){
+        for(int i=1; i<(int)size(); ++i){
             if(elem[i].x < _min.x) _min.x = elem[i].x;
             if(elem[i].y < _min.y) _min.y = elem[i].y;
+            if(elem[i].z < _min.z) _min.z = elem[i].z;
             if(elem[i].x > _max.x) _max.x = elem[i].x;
             if(elem[i].y > _max.y) _max.y = elem[i].y;
+            if(elem[i].z > _max.z) _max.z = elem[i].z;
         }
         return std::make_pair(_min, _max);
     }
 
     /**
-     * @brief xyサイズ
+     * @brief xyzサイズ
     */
     Coord get_size() const {
         Coord _min=elem[0], _max=elem[0];
-        for(int i=1; i<(int)omino_size; ++i){
+        for(int i=1; i<(int)size(); ++i){
             if(elem[i].x < _min.x) _min.x = elem[i].x;
             if(elem[i].y < _min.y) _min.y = elem[i].y;
+            if(elem[i].z < _min.z) _min.z = elem[i].z;
             if(elem[i].x > _max.x) _max.x = elem[i].x;
             if(elem[i].y > _max.y) _max.y = elem[i].y;
+            if(elem[i].z > _max.z) _max.z = elem[i].z;
         }
         return _max - _min;
     }
@@ -591,13 +793,13 @@ struct Polyomino{
      * @note O(omino_size^2)
     */
     bool is_same_pose(Polyomino const & p) const {
-        // 左下の座標に合わせる
+        // 左上の座標に合わせる(三次元ではget_bottomleft_posが一意に決まらないため)
         // std::cout << p.get_base_pos() << " " << get_base_pos() << std::endl;
-        Coord base = p[p.get_bottomleft_pos()] - elem[get_bottomleft_pos()];
+        Coord base = p[p.get_topleft_pos()] - elem[get_topleft_pos()];
         bool flag_found;
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             flag_found = false;
-            for(int j=0; j<(int)omino_size; ++j){
+            for(int j=0; j<(int)size(); ++j){
                 // 各マスについて同じ座標のマスがあるか調べる
                 if(p[i] == elem[j] + base){
                     flag_found = true;
@@ -612,8 +814,17 @@ struct Polyomino{
     /**
      * @brief 回転・鏡像を考えて同じ形かどうか
      * @note O(omino_size^2) * 8
+     * @note 三次元では24通りの回転のみ考える(鏡像は別の形)
     */
     bool is_same(Polyomino const & p) const {
+        if constexpr (omino_dim == 3){
+            for(int t=0; t<24; ++t){
+                Polyomino q = *this;
+                for(auto & c : q.elem) c = oriented(c, t);
+                if(q.is_same_pose(p)) return true;
+            }
+            return false;
+        }
         Polyomino origin = *this;
         // std::cout << "元の形状: ";
         // p.print_debug();
@@ -654,7 +865,7 @@ struct Polyomino{
     */
     void bottomleft_adjustment(){
         Coord min_c = elem[get_bottomleft_pos()];
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             elem[i] -= min_c;
         }
     }
@@ -664,7 +875,7 @@ struct Polyomino{
     */
     void topleft_adjustment(){
         Coord min_c = elem[get_topleft_pos()];
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             elem[i] -= min_c;
         }
     }
@@ -682,7 +893,7 @@ struct Polyomino{
      * @brief このポリオミノを時計回りに90度回転させる
     */
     Polyomino & rotate_clockwise(){
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             std::swap(elem[i].x, elem[i].y);
             elem[i].y *= -1;
         }
@@ -702,7 +913,7 @@ struct Polyomino{
      * @brief このポリオミノを180度回転させる
     */
     Polyomino & rotate_180(){
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             elem[i].x *= -1;
             elem[i].y *= -1;
         }
@@ -722,7 +933,7 @@ struct Polyomino{
      * @brief このポリオミノをy軸に関して鏡像変換させる
     */
     Polyomino & reflecte(){
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             elem[i].x *= -1;
         }
         return *this;
@@ -798,6 +1009,10 @@ struct Polyomino{
                 if(tmp_board[tmp_cand[i] + Coord( 0,  1)] == 0) { tmp_cand.emplace_back(tmp_cand[i] + Coord( 0,  1)); tmp_board[tmp_cand[i] + Coord( 0,  1)] = 1; }
                 if(tmp_board[tmp_cand[i] + Coord(-1,  0)] == 0) { tmp_cand.emplace_back(tmp_cand[i] + Coord(-1,  0)); tmp_board[tmp_cand[i] + Coord(-1,  0)] = 1; }
                 if(tmp_board[tmp_cand[i] + Coord( 0, -1)] == 0) { tmp_cand.emplace_back(tmp_cand[i] + Coord( 0, -1)); tmp_board[tmp_cand[i] + Coord( 0, -1)] = 1; }
+                if constexpr (omino_dim == 3){
+                    if(tmp_board[tmp_cand[i] + Coord(0, 0,  1)] == 0) { tmp_cand.emplace_back(tmp_cand[i] + Coord(0, 0,  1)); tmp_board[tmp_cand[i] + Coord(0, 0,  1)] = 1; }
+                    if(tmp_board[tmp_cand[i] + Coord(0, 0, -1)] == 0) { tmp_cand.emplace_back(tmp_cand[i] + Coord(0, 0, -1)); tmp_board[tmp_cand[i] + Coord(0, 0, -1)] = 1; }
+                }
             }
 
             enumeration(polyominos, now, tmp_board, tmp_cand, depth+1);
@@ -851,10 +1066,30 @@ struct Polyomino{
 
     /**
      * @brief baseをもとに回転・鏡像のパターンを列挙する
+     * @param[in] mirror 鏡像も使うか(falseなら回転のみ)
      * @note DrawablePolyominoも処理できるようにするためtemplateを使用
+     * @note 三次元では24通りの回転(mirrorなら鏡像を含めて48通り)を全て試し, 平行移動で重なる向きを除く
     */
     template <typename OminoType>
-    static void pattern_enumeration(std::vector<std::vector<OminoType>> & pattern, std::vector<OminoType> const & base){
+    static void pattern_enumeration(std::vector<std::vector<OminoType>> & pattern, std::vector<OminoType> const & base, bool const mirror = true){
+        if constexpr (omino_dim == 3){
+            pattern.assign(base.size(), {});
+            for(int i=0; i<(int)base.size(); ++i){
+                std::vector<std::vector<Coord>> seen;   // 左上を(0,0)にしてソートしたマス
+                for(int t=0; t<(mirror ? 48 : 24); ++t){
+                    OminoType q = base[i];
+                    for(auto & c : q.elem) c = oriented(c, t);
+                    q.topleft_adjustment();
+                    std::vector<Coord> key = q.elem;
+                    std::sort(key.begin(), key.end());
+                    if(std::find(seen.begin(), seen.end(), key) != seen.end()) continue;
+                    seen.push_back(std::move(key));
+                    pattern[i].emplace_back(std::move(q));
+                }
+            }
+            return;
+        }
+
         // 回転・鏡像を得る
         pattern.resize(base.size());
         for(int i=0; i<(int)base.size(); ++i){
@@ -862,7 +1097,7 @@ struct Polyomino{
             int rotationity = 0, reflectionity = 0;
             // 回転性・鏡像性を調べて重複する形状はスルー
             rotationity = (p.rotationity_90()) ? 1 : ((p.rotationity_180()) ? 2 : 4);
-            reflectionity = p.reflectionity() ? 1 : 2;
+            reflectionity = (mirror && !p.reflectionity()) ? 2 : 1;
 
             // 実際に回転・鏡像を追加
             OminoType origin = p;
@@ -912,6 +1147,30 @@ struct Polyomino{
     //     }
     // }
 
+    /**
+     * @brief 三次元の向きtでマスを変換する(0から23は回転, 24から47は鏡像を含む変換)
+     * @note 軸の並べ替えと符号の反転の組み合わせ48通りを, 行列式の符号で分けて並べる
+    */
+    static Coord oriented(Coord const & c, int const t){
+        // [向き] -> (新しいx, y, zに使う元の軸, 符号)
+        static std::array<std::array<int, 6>, 48> const table = [](){
+            std::array<std::array<int, 6>, 48> res{};
+            int num[2] = {0, 24};
+            std::array<int, 3> perm = {0, 1, 2};
+            do{
+                int const parity = (perm[0] > perm[1]) + (perm[0] > perm[2]) + (perm[1] > perm[2]);
+                for(int sign=0; sign<8; ++sign){
+                    int const flip = parity + (sign & 1) + ((sign >> 1) & 1) + ((sign >> 2) & 1);
+                    res[num[flip & 1]++] = {perm[0], perm[1], perm[2], (sign & 1) ? -1 : 1, (sign & 2) ? -1 : 1, (sign & 4) ? -1 : 1};
+                }
+            }while(std::next_permutation(perm.begin(), perm.end()));
+            return res;
+        }();
+        int const v[3] = {c.x, c.y, c.z};
+        auto const & e = table[t];
+        return {e[3] * v[e[0]], e[4] * v[e[1]], e[5] * v[e[2]]};
+    }
+
 #if 0
     /**
      * @brief 回転・鏡像を考慮した独立なポリオミノの列挙, Redelmeier'sアルゴリズムを使用
@@ -921,22 +1180,24 @@ struct Polyomino{
     }
 #endif
 
+#ifndef POLYOMINO_HEADLESS
     /**
      * @brief 特定の位置に出力, 1-indexedに注意
     */
     void print_color(int const w=1, int const h=1) const {
-        for(int i=0; i<(int)omino_size; ++i){
+        for(int i=0; i<(int)size(); ++i){
             std::cout << "\033[" << h + elem[i].y << ";" << w * 2 - 1 + elem[i].x * 2 << "H" << CB_Blue << "  " << CB_Clear;
         }
     }
+#endif
 
     /**
      * @brief デバグ用出力
     */
     void print_debug() const {
         std::cout << "{";
-        for(int i=0; i<(int)omino_size; ++i){
-            if(i == omino_size-1) std::cout << "(" << elem[i] << ")";
+        for(int i=0; i<(int)size(); ++i){
+            if(i == (int)size()-1) std::cout << "(" << elem[i] << ")";
             else std::cout << "(" << elem[i] << "), ";
         }
         std::cout << "}" << std::endl;
@@ -944,8 +1205,8 @@ struct Polyomino{
 
     friend std::ostream & operator << (std::ostream & output, Polyomino const & p){
         output << "{";
-        for(int i=0; i<(int)omino_size; ++i){
-            if(i == omino_size-1) output << "(" << p[i] << ")";
+        for(int i=0; i<(int)p.size(); ++i){
+            if(i == (int)p.size()-1) output << "(" << p[i] << ")";
             else output << "(" << p[i] << "), ";
         }
         output << "}";
@@ -961,5 +1222,10 @@ using Heptomino = Polyomino<7>;
 using Octomino = Polyomino<8>;
 using Nonomino = Polyomino<9>;
 using Decomino = Polyomino<10>;
+using MixedOmino = Polyomino<0>;   // マス数を実行時に決める(サイズの異なるピースを混ぜる場合, PieceCatalog::loadで作る)
+using Tricube = Polyomino<3, 3>;
+using Tetracube = Polyomino<4, 3>;
+using Pentacube = Polyomino<5, 3>;
+using MixedCube = Polyomino<0, 3>;  // マス数を実行時に決めるポリキューブ
 
 } // namespace PentominoPuzzle
@@ -0,0 +1,155 @@
+/**
+ * @brief 列ごとの輪郭(フロンティア)を状態とする動的計画法で解の個数を数える
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+#include "polyomino.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief w×Nの細長い盤面向けの解の個数の計算(転送行列法)
+ * @note 短い辺を列として長い辺の方向にマスを1つずつ進め, 先の何マスが埋まっているか(輪郭)と使用済みのピース(個数)を状態とする
+ * @note 盤面の幅を固定すれば状態数が抑えられるので, 計算量は長さNに対して線形
+ * @note 各マスでは左上のマスから置くsolve()と同じ順にピースを置くので, 数える解はcount()と一致する
+*/
+template <typename Omino>
+struct ProfileCounter{
+    long long int state_max{};                  // 1マスあたりの状態数の最大
+    long long int transition_num{};             // 状態遷移の回数
+
+    /**
+     * @brief 解の個数を数える
+     * @param[in] puzzle 盤面(HOLE・配置済みのピースを含んでよい)と未使用のピース
+     * @return 解の個数, 空きマスの面積が未使用のピースの面積の和と一致しない場合は0
+     * @note 未使用のピースの個数のビット表現が64ビットを超える, もしくはピースが輪郭の64マスに収まらない場合はpuzzle.count()で数える
+    */
+    long long int count(PackingPuzzle<Omino> & puzzle){
+        Board const & b = puzzle.board;
+        state_max = transition_num = 0;
+
+        // 短い辺を列にする(列の中の位置をc, 進む方向の位置をaとする)
+        bool const transpose = b.h_size > b.w_size;
+        int const len = (int)(transpose ? b.h_size : b.w_size);
+        int const col = (int)(transpose ? b.w_size : b.h_size);
+        auto at = [&](int const a, int const c){ return transpose ? b[c][a] : b[a][c]; };
+
+        int empty_num = 0;
+        for(int a=0; a<len; ++a){
+            for(int c=0; c<col; ++c) empty_num += (at(a, c) == EMPTY);
+        }
+        if(empty_num != puzzle.remain_area()) return 0;
+
+        // 使用済みのピースは, 未使用のピースごとに残りの個数が収まる幅のビット列に個数を入れて表す(1個ずつなら1ビット)
+        std::vector<int> shift(puzzle.base.size());
+        std::vector<unsigned long long> field(puzzle.base.size());
+        int bits = 0;
+        for(int i=0; i<(int)puzzle.base.size(); ++i){
+            if(!puzzle.unuse[i]) continue;
+            int const w = std::bit_width((unsigned int)puzzle.unuse[i]);
+            shift[i] = bits;
+            if(bits + w <= 64) field[i] = ((1ULL << w) - 1) << bits;
+            bits += w;
+        }
+        if(bits > 64) return puzzle.count();
+
+        // 各マスに置ける配置を事前に求める(盤面の状態だけで決まる)
+        std::vector<std::vector<Placement>> place(len * col);
+        for(int i=0; i<(int)puzzle.pattern.size(); ++i){
+            if(!puzzle.unuse[i]) continue;
+            for(auto const & shape : puzzle.pattern[i]){
+                std::vector<Coord> cell;
+                for(int k=0; k<(int)shape.size(); ++k){
+                    cell.push_back(transpose ? Coord{shape[k].y, shape[k].x} : shape[k]);
+                }
+                // 進む順(a, cの辞書順)で最初のマスを基準にする
+                std::sort(cell.begin(), cell.end());
+                Coord const top = cell.front();
+                int max_off = 0;
+                for(auto & e : cell){
+                    e -= top;
+                    max_off = std::max(max_off, e.x * col + e.y);
+                }
+                if(max_off >= 64) return puzzle.count();
+
+                for(int a=0; a<len; ++a){
+                    for(int c=0; c<col; ++c){
+                        Placement pl{0, 1ULL << shift[i], field[i], (unsigned long long)puzzle.unuse[i] << shift[i]};
+                        bool flag_fit = true;
+                        for(auto const & e : cell){
+                            int const na = a + e.x, nc = c + e.y;
+                            if(na >= len || nc < 0 || nc >= col || at(na, nc) != EMPTY){
+                                flag_fit = false;
+                                break;
+                            }
+                            pl.mask |= 1ULL << (e.x * col + e.y);
+                        }
+                        if(flag_fit) place[a * col + c].push_back(pl);
+                    }
+                }
+            }
+        }
+
+        // マスを1つずつ進める, 輪郭のビット0が現在のマス
+        std::unordered_map<State, long long int, StateHash> cur, nxt;
+        cur[{0, 0}] = 1;
+        for(int p=0; p<len*col; ++p){
+            bool const empty = (at(p / col, p % col) == EMPTY);
+            for(auto const & [s, num] : cur){
+                if(!empty || (s.profile & 1)){
+                    nxt[{s.profile >> 1, s.used}] += num;
+                    continue;
+                }
+                for(auto const & pl : place[p]){
+                    if((s.profile & pl.mask) || (s.used & pl.field) >= pl.limit) continue;
+                    ++transition_num;
+                    nxt[{(s.profile | pl.mask) >> 1, s.used + pl.piece}] += num;
+                }
+            }
+            std::swap(cur, nxt);
+            nxt.clear();
+            state_max = std::max(state_max, (long long int)cur.size());
+            if(cur.empty()) return 0;
+        }
+
+        // 面積が一致しているので, 全てのマスを埋めた状態では全てのピースを使っている
+        long long int res = 0;
+        for(auto const & [s, num] : cur) res += num;
+        return res;
+    }
+
+private:
+    /**
+     * @brief 基準のマスに置いたときに埋まるマス(輪郭のビット)とピースの個数に足す値
+    */
+    struct Placement{
+        unsigned long long mask;
+        unsigned long long piece;
+        unsigned long long field;               // ピースの個数のビット
+        unsigned long long limit;               // ピースの個数の上限(fieldの位置)
+    };
+
+    struct State{
+        unsigned long long profile;             // 現在のマスから先の埋まっているマス
+        unsigned long long used;                // 使用済みのピースの個数
+
+        bool operator == (State const & rhs) const {
+            return profile == rhs.profile && used == rhs.used;
+        }
+    };
+
+    struct StateHash{
+        size_t operator () (State const & s) const {
+            unsigned long long v = s.profile * 0x9E3779B97F4A7C15ULL;
+            v ^= s.used * 0xC2B2AE3D27D4EB4FULL;
+            return (size_t)(v ^ (v >> 29));
+        }
+    };
+};
+
+} // namespace PolyominoPuzzle
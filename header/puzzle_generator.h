@@ -0,0 +1,223 @@
+/**
+ * @brief 解がちょうど1つの問題(HOLE・置いてあるピース付きの盤面)を並列に作る
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include "polyomino.h"
+#include "piece_catalog.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 唯一解の問題の生成器
+ * @note 候補の盤面(ひな形にランダムなHOLEを加えたもの)の解を1つランダムに作り, その解のピースをヒントとして置いていく
+ * @note ヒントを置くたびにcount_upto(2)で解が2つ目まで探し, 1つになった時点で採用する(全ての解は数えない)
+ * @note 各スレッドは自分のPackingPuzzleを使い回すので, 同じひな形の候補の間でキャッシュが効く
+*/
+template <typename Omino>
+struct UniquePuzzleGenerator{
+    /**
+     * @brief 作った問題
+    */
+    struct Puzzle{
+        Board board;                    // 問題の盤面(HOLEとヒントのピース, 残りはEMPTY)
+        Board solution;                 // 唯一の解
+        std::vector<int> unuse;         // 問題で残っているピースの個数
+        int clue_num{};                 // ヒントとして置いたピースの数
+    };
+
+    Board base;                         // ひな形の盤面(EMPTY以外はそのまま問題に残る)
+    std::vector<int> inventory;         // 使うピースの個数(空なら1個ずつ)
+    int hole_num = 0;                   // 候補ごとにランダムに加えるHOLEの数
+    int max_clues = -1;                 // ヒントの数の上限(負なら無制限, 0ならHOLEだけの問題)
+    bool flag_minimize = true;          // 唯一解になった後, 外しても唯一解のままのヒントを外すか
+    long long int node_limit = 200000;  // 1回の探索のノード数の上限(超えた候補は捨てる)
+    int thread_num = 0;                 // 使うスレッド数(0ならハードウェアのスレッド数)
+    unsigned long long seed = 1;        // 乱数の種(スレッドごとにずらして使う)
+    long long int candidate_num{};      // 試した候補の数
+    long long int check_num{};          // 唯一解かどうかを調べた回数
+    double total_ms{};                  // generateにかかった時間[ms]
+
+    UniquePuzzleGenerator(Board const & _base, std::shared_ptr<PieceCatalog<Omino> const> _catalog = PieceCatalog<Omino>::standard()) : base(_base), catalog(std::move(_catalog)){}
+
+    /**
+     * @brief 互いに異なる唯一解の問題をnum個作る
+     * @param[in] f 問題ごとに呼ぶ関数(呼び出しは排他される), falseを返すと打ち切る
+     * @return 作った問題の数
+     * @note ひな形の空きマスからhole_numを引いた面積がピースの面積の和と異なれば何も作らない
+     * @note それ以外で候補がいつまでも見つからない設定では, max_candidates個試した時点で打ち切る
+    */
+    template <typename Func>
+    int generate(int const num, Func && f, long long int const max_candidates = 1000000){
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<int> inv = inventory;
+        if(inv.empty()) inv.assign(catalog->base.size(), 1);
+        int area = 0;
+        for(int i=0; i<(int)inv.size(); ++i) area += inv[i] * (int)catalog->base[i].size();
+        for(int k=0; k<base.cell_num(); ++k) area -= (base[base.coord(k)] == EMPTY);
+        candidate_num = check_num = 0;
+        total_ms = 0;
+        if(area != -hole_num) return 0;
+        std::atomic<int> made{0};
+        std::atomic<long long int> tried{0}, checked{0};
+        std::atomic<bool> stop{false};
+        std::mutex mtx;
+        std::set<std::vector<std::vector<int>>> seen;   // 作った問題の盤面(重複を除く)
+
+        auto worker = [&](int const id){
+            PackingPuzzle<Omino> puzzle(0, 0, catalog);
+            std::mt19937_64 rng(seed * 0x9E3779B97F4A7C15ULL + id);
+            Puzzle res;
+            long long int checks = 0;
+            while(!stop && made < num && tried++ < max_candidates){
+                if(!make(puzzle, inv, rng, res, checks)) continue;
+                std::lock_guard<std::mutex> lock(mtx);
+                if(stop || made >= num || !seen.insert(res.board.board).second) continue;
+                ++made;
+                if(!f(static_cast<Puzzle const &>(res))) stop = true;
+            }
+            checked += checks;
+        };
+        int const threads_num = std::max(1, std::min(thread_num > 0 ? thread_num : (int)std::thread::hardware_concurrency(), num));
+        std::vector<std::thread> threads;
+        for(int t=1; t<threads_num; ++t) threads.emplace_back(worker, t);
+        worker(0);
+        for(auto & th : threads) th.join();
+
+        candidate_num = std::min(tried.load(), max_candidates);
+        check_num = checked;
+        total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return made;
+    }
+
+    /**
+     * @brief 1分あたりに作った問題の数
+    */
+    double puzzles_per_min(int const num) const {
+        return total_ms > 0 ? num * 60000.0 / total_ms : 0;
+    }
+
+private:
+    /**
+     * @brief 置いたピース
+    */
+    struct Placed{
+        int piece;
+        int pattern;
+        Coord origin;                   // aabbの左上(Board::put_pieceと同じ)
+    };
+
+    std::shared_ptr<PieceCatalog<Omino> const> catalog;
+
+    /**
+     * @brief 候補を1つ作り, 唯一解の問題にできればresに入れる
+     * @param[in,out] checks count_uptoを呼んだ回数
+    */
+    template <typename Rng>
+    bool make(PackingPuzzle<Omino> & puzzle, std::vector<int> const & inv, Rng & rng, Puzzle & res, long long int & checks){
+        // ひな形にランダムなHOLEを加える
+        Board cand = base;
+        std::vector<Coord> empty;
+        for(int k=0; k<cand.cell_num(); ++k){
+            if(cand[cand.coord(k)] == EMPTY) empty.push_back(cand.coord(k));
+        }
+        if((int)empty.size() < hole_num) return false;
+        for(int k=0; k<hole_num; ++k){
+            std::swap(empty[k], empty[k + rng() % (empty.size() - k)]);
+            cand[empty[k]] = HOLE;
+        }
+
+        // ランダムな解を1つ作る
+        puzzle.board = cand;
+        puzzle.set_inventory(inv);
+        std::vector<Placed> placed;
+        if(!random_fill(puzzle, rng, placed)) return false;
+        res.solution = puzzle.board;
+
+        // 唯一解になるまで解のピースをヒントとして置く
+        std::shuffle(placed.begin(), placed.end(), rng);
+        puzzle.board = cand;
+        puzzle.set_inventory(inv);
+        int clue = 0;
+        while(true){
+            ++checks;
+            long long int const num = puzzle.count_upto(2, node_limit);
+            if(num < 0) return false;
+            if(num == 1) break;
+            if(clue == (int)placed.size() || (max_clues >= 0 && clue >= max_clues)) return false;
+            put(puzzle, placed[clue++], true);
+        }
+
+        // 外しても唯一解のままのヒントを外す
+        if(flag_minimize){
+            for(int k=clue-1; k>=0; --k){
+                put(puzzle, placed[k], false);
+                ++checks;
+                if(puzzle.count_upto(2, node_limit) == 1){
+                    placed.erase(placed.begin() + k);
+                    --clue;
+                }else{
+                    put(puzzle, placed[k], true);
+                }
+            }
+        }
+        res.board = puzzle.board;
+        res.unuse = puzzle.unuse;
+        res.clue_num = clue;
+        return true;
+    }
+
+    /**
+     * @brief ヒントのピースを置く(flagがfalseなら取り除く)
+    */
+    static void put(PackingPuzzle<Omino> & puzzle, Placed const & p, bool const flag){
+        puzzle.board.put_piece(puzzle.kernel[p.piece][p.pattern], p.origin, flag ? p.piece : EMPTY);
+        puzzle.unuse[p.piece] += flag ? -1 : 1;
+    }
+
+    /**
+     * @brief 最も左上のEMPTYに置ける配置をランダムな順に試し, 残りが埋められるものを選んで盤面を埋める
+     * @note 埋められるかはfeasibleで調べるので, 選んだ配置をやり直すことはない
+    */
+    template <typename Rng>
+    bool random_fill(PackingPuzzle<Omino> & puzzle, Rng & rng, std::vector<Placed> & placed){
+        if(puzzle.feasible(node_limit) != Feasibility::yes) return false;
+        std::vector<Placed> cand;
+        while(true){
+            Coord const place = puzzle.board.get_topleft({0, 0}, EMPTY);
+            if(place.x < 0) return true;
+            cand.clear();
+            for(int i=0; i<(int)puzzle.kernel.size(); ++i){
+                if(!puzzle.unuse[i]) continue;
+                for(int j=0; j<(int)puzzle.kernel[i].size(); ++j){
+                    Coord const origin = place - puzzle.kernel[i][j].anchor;
+                    if(puzzle.board.putable(puzzle.kernel[i][j], origin)) cand.push_back({i, j, origin});
+                }
+            }
+            std::shuffle(cand.begin(), cand.end(), rng);
+            bool found = false;
+            for(auto const & p : cand){
+                put(puzzle, p, true);
+                Feasibility const fe = puzzle.feasible(node_limit);
+                if(fe == Feasibility::yes){
+                    placed.push_back(p);
+                    found = true;
+                    break;
+                }
+                put(puzzle, p, false);
+                if(fe == Feasibility::unknown) return false;
+            }
+            if(!found) return false;
+        }
+    }
+};
+
+} // namespace PolyominoPuzzle
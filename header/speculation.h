@@ -0,0 +1,137 @@
+/**
+ * @brief 配置する前に, 配置しそうな場所の解の個数を裏で数えておく
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include "polyomino.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief 投機的に解の個数を数えるバックグラウンドのワーカー
+ * @note 生成時にPackingPuzzleを一度だけコピーし, 以降は盤面とピースの使用状況だけを受け取って数える
+ * @note 盤面が変わると以前の結果は破棄し, 新しい依頼が来ると未着手の依頼は取り消す
+*/
+template <typename Omino>
+struct SpeculativeCounter{
+    /**
+     * @brief 数える配置
+    */
+    struct Placement{
+        int piece;                      // ピース番号
+        int pattern;                    // 回転・鏡像のパターン番号
+        Coord pos;                      // 配置場所(aabbの左上, Board::put_pieceと同じ)
+
+        bool operator < (Placement const & rhs) const {
+            return std::tie(piece, pattern, pos) < std::tie(rhs.piece, rhs.pattern, rhs.pos);
+        }
+
+        bool operator == (Placement const & rhs) const {
+            return piece == rhs.piece && pattern == rhs.pattern && pos == rhs.pos;
+        }
+    };
+
+    SpeculativeCounter(PackingPuzzle<Omino> const & puzzle) : local(puzzle), worker([this](){ run(); }){}
+
+    SpeculativeCounter(SpeculativeCounter const &) = delete;
+    SpeculativeCounter & operator = (SpeculativeCounter const &) = delete;
+
+    ~SpeculativeCounter(){
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            flag_stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    /**
+     * @brief 盤面boardに対してlistの配置を先頭から順に数えるよう依頼する
+     * @note 前回の依頼のうち未着手のものは取り消す, 数え終わった結果は盤面が同じなら残す
+    */
+    void request(Board const & board, std::vector<int> const & unuse, std::vector<Placement> const & list){
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(!(job_unuse == unuse && job_board == board)){
+                job_board = board;
+                job_unuse = unuse;
+                result.clear();
+                ++job_id;
+            }
+            queue.clear();
+            for(auto const & p : list){
+                if(result.count(p) || (flag_running && running == p)) continue;
+                queue.push_back(p);
+            }
+        }
+        cv.notify_all();
+    }
+
+    /**
+     * @brief 盤面boardに配置pを置いた後の解の個数を取り出す
+     * @param[out] num 解の個数
+     * @return 数え終わっていればtrue, 数えている最中なら終わるまで待つ
+    */
+    bool lookup(Board const & board, std::vector<int> const & unuse, Placement const & p, long long int & num){
+        std::unique_lock<std::mutex> lock(mtx);
+        if(!(job_unuse == unuse && job_board == board)) return false;
+        cv.wait(lock, [&](){ return !(flag_running && running == p); });
+        auto it = result.find(p);
+        if(it == result.end()) return false;
+        num = it->second;
+        return true;
+    }
+
+private:
+    PackingPuzzle<Omino> local;                 // ワーカー専用のコピー
+    std::mutex mtx;
+    std::condition_variable cv;
+    Board job_board;                            // 依頼された盤面
+    std::vector<int> job_unuse;                 // 依頼されたピースの使用状況
+    int job_id{};                               // 盤面が変わるたびに増える
+    std::deque<Placement> queue;                // 未着手の配置
+    std::map<Placement, long long int> result;  // 数え終わった配置 -> 解の個数
+    Placement running{};                        // 数えている最中の配置
+    bool flag_running{};
+    bool flag_stop{};
+    std::thread worker;
+
+    void run(){
+        std::unique_lock<std::mutex> lock(mtx);
+        while(true){
+            cv.wait(lock, [&](){ return flag_stop || !queue.empty(); });
+            if(flag_stop) return;
+            Placement const p = queue.front();
+            queue.pop_front();
+            int const id = job_id;
+            local.board = job_board;
+            local.unuse = job_unuse;
+            running = p;
+            flag_running = true;
+            lock.unlock();
+
+            long long int num = -1;
+            auto const & ker = local.kernel[p.piece][p.pattern];
+            if(local.unuse[p.piece] && local.board.putable(ker, p.pos)){
+                local.board.put_piece(ker, p.pos, p.piece);
+                --local.unuse[p.piece];
+                num = local.count();
+            }
+
+            lock.lock();
+            flag_running = false;
+            if(id == job_id && num >= 0) result[p] = num;
+            cv.notify_all();
+        }
+    }
+};
+
+} // namespace PolyominoPuzzle
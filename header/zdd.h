@@ -0,0 +1,398 @@
+/**
+ * @brief 解全体をゼロサプレス型二分決定グラフ(ZDD)で表す
+*/
+
+#pragma once
+
+#include <climits>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include "polyomino.h"
+#include "omino_packing.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief ZDDの変数となるピースの配置
+*/
+struct ZddPlacement{
+    int piece;                      // ピース番号
+    int pattern;                    // 回転・鏡像のパターン番号
+    Coord pos;                      // 配置場所(aabbの左上, Board::put_pieceと同じ)
+    std::vector<Coord> cell;        // 埋めるマス
+};
+
+/**
+ * @brief 解(配置の集合)の族を表すZDD
+ * @note 変数は配置の番号で, 配置は左上のマスの探索順(x * h + y)に並ぶ
+ * @note ノード0が空の族(解なし), ノード1が空集合のみの族(全て埋まった)を表す
+ * @note 子のノードは親より先に作られるので, ノード番号の昇順が葉から根への順になる
+*/
+struct Zdd{
+    struct Node{
+        int var;                    // 配置の番号
+        int lo, hi;                 // 配置を含まない/含む場合の子
+    };
+
+    Board board;                                // 探索を始めた盤面
+    std::vector<ZddPlacement> placement;        // 変数の一覧
+    std::vector<Node> node{{INT_MAX, 0, 0}, {INT_MAX, 1, 1}};
+    int root = 0;
+
+    /**
+     * @brief ノードを作る(同じノードがあればそれを返す)
+     * @note hiが空の族なら配置を含む解はないのでloを返す
+    */
+    int make(int const var, int const lo, int const hi){
+        if(hi == 0) return lo;
+        if(unique.size() + 2 != node.size()) rebuild_unique();
+        auto [it, inserted] = unique.try_emplace({var, lo, hi}, (int)node.size());
+        if(inserted) node.push_back({var, lo, hi});
+        return it->second;
+    }
+
+    /**
+     * @brief 解の個数
+    */
+    long long int count(){
+        count_table();
+        return num[root];
+    }
+
+    /**
+     * @brief 解を一様ランダムに1つ選ぶ
+     * @return 解に含まれる配置の番号, 解がなければ空
+    */
+    template <typename Rng>
+    std::vector<int> sample(Rng & rng){
+        count_table();
+        std::vector<int> res;
+        if(num[root] == 0) return res;
+        int n = root;
+        while(n > 1){
+            long long int r = std::uniform_int_distribution<long long int>(0, num[n] - 1)(rng);
+            if(r < num[node[n].lo]){
+                n = node[n].lo;
+            }else{
+                res.push_back(node[n].var);
+                n = node[n].hi;
+            }
+        }
+        return res;
+    }
+
+    /**
+     * @brief 配置の番号を探す
+     * @param[in] piece ピース番号
+     * @param[in] pattern 回転・鏡像のパターン番号
+     * @param[in] pos 配置場所(aabbの左上)
+     * @return 配置の番号, 変数にない配置なら-1
+    */
+    int find_placement(int const piece, int const pattern, Coord const pos) const {
+        for(int i=0; i<(int)placement.size(); ++i){
+            auto const & pl = placement[i];
+            if(pl.piece == piece && pl.pattern == pattern && pl.pos == pos) return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief 配置varを含む解だけを残したZDD
+    */
+    Zdd filter(int const var) const {
+        Zdd res;
+        res.board = board;
+        res.placement = placement;
+        std::unordered_map<int, int> memo;
+        res.root = filter_rec(res, root, var, memo);
+        return res;
+    }
+
+    /**
+     * @brief 全ての解についてfを呼ぶ
+     * @param[in] f 解に含まれる配置の番号の列を受け取る関数
+    */
+    template <typename Func>
+    void for_each(Func && f) const {
+        std::vector<int> now;
+        for_each_rec(root, now, f);
+    }
+
+    /**
+     * @brief 配置の番号の列から盤面を作る
+    */
+    Board to_board(std::vector<int> const & sol) const {
+        Board res = board;
+        for(auto const v : sol){
+            for(auto const & c : placement[v].cell) res[c] = placement[v].piece;
+        }
+        return res;
+    }
+
+    /**
+     * @brief ファイルに保存する
+     * @return 書き込めたかどうか
+    */
+    bool save(std::string const & path) const {
+        std::ofstream ofs(path, std::ios::binary);
+        if(!ofs) return false;
+        write(ofs, magic);
+        write(ofs, (int)board.w_size);
+        write(ofs, (int)board.h_size);
+        for(auto const & col : board.board){
+            for(auto const v : col) write(ofs, v);
+        }
+        write(ofs, (int)placement.size());
+        for(auto const & pl : placement){
+            write(ofs, pl.piece);
+            write(ofs, pl.pattern);
+            write(ofs, pl.pos);
+            write(ofs, (int)pl.cell.size());
+            for(auto const & c : pl.cell) write(ofs, c);
+        }
+        write(ofs, (int)node.size());
+        for(int i=2; i<(int)node.size(); ++i) write(ofs, node[i]);
+        write(ofs, root);
+        return (bool)ofs;
+    }
+
+    /**
+     * @brief ファイルから読み込む
+     * @return 読み込めたかどうか(失敗した場合は空の族になる)
+    */
+    bool load(std::string const & path){
+        *this = Zdd();
+        std::ifstream ifs(path, std::ios::binary);
+        int m = 0, w = 0, h = 0, n = 0;
+        if(!ifs || !read(ifs, m) || m != magic || !read(ifs, w) || !read(ifs, h) || w < 0 || h < 0) return false;
+        Board b(w, h);
+        for(auto & col : b.board){
+            for(auto & v : col) if(!read(ifs, v)) return false;
+        }
+        if(!read(ifs, n) || n < 0) return false;
+        std::vector<ZddPlacement> pls(n);
+        for(auto & pl : pls){
+            int k = 0;
+            if(!read(ifs, pl.piece) || !read(ifs, pl.pattern) || !read(ifs, pl.pos) || !read(ifs, k) || k < 0) return false;
+            pl.cell.resize(k);
+            for(auto & c : pl.cell) if(!read(ifs, c) || !b.in(c)) return false;
+        }
+        if(!read(ifs, n) || n < 2) return false;
+        std::vector<Node> nodes(node);
+        nodes.resize(n);
+        for(int i=2; i<n; ++i){
+            Node & e = nodes[i];
+            if(!read(ifs, e) || e.var < 0 || e.var >= (int)pls.size() || e.lo < 0 || e.lo >= i || e.hi <= 0 || e.hi >= i) return false;
+        }
+        int r = 0;
+        if(!read(ifs, r) || r < 0 || r >= n) return false;
+        board = std::move(b);
+        placement = std::move(pls);
+        node = std::move(nodes);
+        root = r;
+        return true;
+    }
+
+private:
+    static constexpr int magic = 0x3144445A;    // "ZDD1"
+    struct NodeHash{
+        size_t operator () (Node const & e) const {
+            unsigned long long v = (unsigned long long)e.var * 0x9E3779B97F4A7C15ULL;
+            v ^= ((unsigned long long)e.lo << 32 | (unsigned int)e.hi) * 0xC2B2AE3D27D4EB4FULL;
+            return (size_t)(v ^ (v >> 29));
+        }
+    };
+
+    struct NodeEqual{
+        bool operator () (Node const & a, Node const & b) const {
+            return a.var == b.var && a.lo == b.lo && a.hi == b.hi;
+        }
+    };
+
+    std::unordered_map<Node, int, NodeHash, NodeEqual> unique;  // (var, lo, hi) -> ノード
+    std::vector<long long int> num;                             // 各ノードの解の個数
+
+    void rebuild_unique(){
+        unique.clear();
+        for(int i=2; i<(int)node.size(); ++i) unique.emplace(node[i], i);
+    }
+
+    /**
+     * @brief 各ノードの解の個数を葉から順に求める
+    */
+    void count_table(){
+        if(num.size() == node.size()) return;
+        num.assign(node.size(), 0);
+        num[1] = 1;
+        for(int i=2; i<(int)node.size(); ++i) num[i] = num[node[i].lo] + num[node[i].hi];
+    }
+
+    int filter_rec(Zdd & res, int const n, int const var, std::unordered_map<int, int> & memo) const {
+        if(n <= 1 || node[n].var > var) return 0;
+        if(node[n].var == var) return res.make(var, 0, copy_rec(res, node[n].hi, memo));
+        if(auto it = memo.find(n); it != memo.end()) return it->second;
+        int const lo = filter_rec(res, node[n].lo, var, memo);
+        int const hi = filter_rec(res, node[n].hi, var, memo);
+        return memo[n] = res.make(node[n].var, lo, hi);
+    }
+
+    /**
+     * @brief nより下のノードをそのままresにコピーする(memoはfilter_recと共用, キーの符号で区別)
+    */
+    int copy_rec(Zdd & res, int const n, std::unordered_map<int, int> & memo) const {
+        if(n <= 1) return n;
+        if(auto it = memo.find(~n); it != memo.end()) return it->second;
+        int const lo = copy_rec(res, node[n].lo, memo);
+        int const hi = copy_rec(res, node[n].hi, memo);
+        return memo[~n] = res.make(node[n].var, lo, hi);
+    }
+
+    template <typename Func>
+    void for_each_rec(int const n, std::vector<int> & now, Func && f) const {
+        if(n == 0) return;
+        if(n == 1){
+            f(now);
+            return;
+        }
+        for_each_rec(node[n].lo, now, f);
+        now.push_back(node[n].var);
+        for_each_rec(node[n].hi, now, f);
+        now.pop_back();
+    }
+
+    static void write(std::ofstream & ofs, int const v){
+        ofs.write(reinterpret_cast<char const *>(&v), sizeof(v));
+    }
+
+    static void write(std::ofstream & ofs, Coord const & c){
+        write(ofs, c.x);
+        write(ofs, c.y);
+    }
+
+    static void write(std::ofstream & ofs, Node const & e){
+        write(ofs, e.var);
+        write(ofs, e.lo);
+        write(ofs, e.hi);
+    }
+
+    static bool read(std::ifstream & ifs, int & v){
+        return (bool)ifs.read(reinterpret_cast<char *>(&v), sizeof(v));
+    }
+
+    static bool read(std::ifstream & ifs, Coord & c){
+        return read(ifs, c.x) && read(ifs, c.y);
+    }
+
+    static bool read(std::ifstream & ifs, Node & e){
+        return read(ifs, e.var) && read(ifs, e.lo) && read(ifs, e.hi);
+    }
+};
+
+/**
+ * @brief PackingPuzzleの盤面と未使用のピースからZDDを作る
+ * @note solve()と同じく左上の空きマスを埋める配置で分岐し, 同じ状態(埋まっているマス, 使用済みのピース)の部分は共有する
+*/
+template <typename Omino>
+struct ZddBuilder{
+    long long int iterate_num{};                // 展開した状態の数
+    long long int memo_hit{};                   // 共有できた状態の数
+
+    /**
+     * @brief ZDDを作る
+     * @note 空きマスの面積が未使用のピースの面積の和と一致しない場合は空の族
+     * @note 盤面とピースの使用状況は呼び出し前の状態に戻る
+    */
+    Zdd build(PackingPuzzle<Omino> & puzzle){
+        Zdd res;
+        res.board = puzzle.board;
+        iterate_num = memo_hit = 0;
+        Board & b = puzzle.board;
+        int const h = (int)b.h_size;
+
+        int empty_num = 0;
+        for(auto const & col : b.board){
+            for(auto const v : col) empty_num += (v == EMPTY);
+        }
+        if(empty_num != puzzle.remain_area()) return res;
+
+        // 変数(配置)の一覧, 左上のマスの探索順に番号を振る
+        var.assign(b.w_size * b.h_size, {});
+        for(int x=0; x<(int)b.w_size; ++x){
+            for(int y=0; y<h; ++y){
+                for(int i=0; i<(int)puzzle.pattern.size(); ++i){
+                    if(!puzzle.unuse[i]) continue;
+                    for(int j=0; j<(int)puzzle.pattern[i].size(); ++j){
+                        auto const & ker = puzzle.kernel[i][j];
+                        Coord const origin = Coord{x, y} - ker.anchor;
+                        if(!b.putable(ker, origin)) continue;
+                        ZddPlacement pl{i, j, origin, {}};
+                        ker.for_each(origin, [&](Coord const & c){ pl.cell.push_back(c); });
+                        var[x * h + y].emplace_back((int)res.placement.size());
+                        res.placement.emplace_back(std::move(pl));
+                    }
+                }
+            }
+        }
+
+        memo.clear();
+        res.root = build_rec(puzzle, res, {0, 0});
+        memo.clear();
+        return res;
+    }
+
+private:
+    std::vector<std::vector<int>> var;          // [マス] -> そのマスを左上とする配置の番号
+    std::unordered_map<std::string, int> memo;  // 状態 -> ノード
+
+    int build_rec(PackingPuzzle<Omino> & puzzle, Zdd & res, Coord place){
+        Board & b = puzzle.board;
+        int const h = (int)b.h_size;
+        place = b.get_topleft(place, EMPTY);
+        if(place.x < 0) return 1;
+
+        // 状態: 埋まっているマス(placeより後ろのみ)と未使用のピース
+        std::string state;
+        int const p = place.x * h + place.y;
+        state.reserve((b.w_size * h - p) / 8 + puzzle.unuse.size() + 8);
+        state.append(reinterpret_cast<char const *>(&p), sizeof(p));
+        unsigned char acc = 0;
+        int bit = 0;
+        auto push = [&](bool const v){
+            acc |= (unsigned char)v << bit;
+            if(++bit == 8){ state.push_back((char)acc); acc = 0; bit = 0; }
+        };
+        for(int q=p; q<(int)(b.w_size * h); ++q) push(b[q / h][q % h] == EMPTY);
+        state.push_back((char)acc);
+        // 同じ形のピースが複数個ある場合もあるので, 残りの個数をそのまま入れる
+        for(auto const u : puzzle.unuse) state.push_back((char)u);
+        if(auto it = memo.find(state); it != memo.end()){
+            ++memo_hit;
+            return it->second;
+        }
+        ++iterate_num;
+
+        // 配置の番号の降順にloの鎖を作る
+        auto const & cand = var[p];
+        int r = 0;
+        for(int k=(int)cand.size()-1; k>=0; --k){
+            ZddPlacement const & pl = res.placement[cand[k]];
+            if(!puzzle.unuse[pl.piece]) continue;
+            bool flag_empty = true;
+            for(auto const & c : pl.cell) flag_empty = flag_empty && b[c] == EMPTY;
+            if(!flag_empty) continue;
+
+            for(auto const & c : pl.cell) b[c] = pl.piece;
+            --puzzle.unuse[pl.piece];
+            int const hi = build_rec(puzzle, res, place);
+            for(auto const & c : pl.cell) b[c] = EMPTY;
+            ++puzzle.unuse[pl.piece];
+            r = res.make(cand[k], r, hi);
+        }
+        memo.emplace(std::move(state), r);
+        return r;
+    }
+};
+
+} // namespace PolyominoPuzzle
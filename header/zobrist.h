@@ -0,0 +1,67 @@
+/**
+ * @brief 配置済みのピースの集合に対するZobristハッシュ
+*/
+
+#pragma once
+
+#include <random>
+#include <vector>
+#include "polyomino.h"
+
+namespace PolyominoPuzzle{
+
+/**
+ * @brief (ピース, 回転・鏡像, 位置)ごとの乱数のXORで盤面の状態を表すハッシュ
+ * @note 置く・取り除くどちらもtoggleで更新でき, 置いた順番によらず同じ値になる
+*/
+struct ZobristHash{
+    std::vector<std::vector<std::vector<unsigned long long>>> table;   // [ピース][パターン][x * h + y] -> 乱数
+    size_t w_size{}, h_size{};
+    unsigned long long value{};                                         // 現在のハッシュ値
+
+    /**
+     * @brief 乱数表を作り, ハッシュ値を0(何も置いていない状態)にする
+     * @param[in] pattern 各ピースの回転・鏡像(個数のみ使う)
+     * @param[in] w 盤面の幅
+     * @param[in] h 盤面の高さ
+     * @param[in] seed 乱数の種
+    */
+    template <typename OminoType>
+    void init(std::vector<std::vector<OminoType>> const & pattern, size_t const w, size_t const h, unsigned long long const seed = 0x9E3779B97F4A7C15ULL){
+        std::mt19937_64 rng(seed);
+        w_size = w;
+        h_size = h;
+        table.assign(pattern.size(), {});
+        for(int i=0; i<(int)pattern.size(); ++i){
+            table[i].assign(pattern[i].size(), std::vector<unsigned long long>(w * h));
+            for(auto & t : table[i]){
+                for(auto & v : t) v = rng();
+            }
+        }
+        value = 0;
+    }
+
+    /**
+     * @brief 配置の乱数
+     * @param[in] pos 配置場所(aabbの左上)
+    */
+    inline unsigned long long key(int const piece, int const pattern, Coord const pos) const {
+        return table[piece][pattern][pos.x * h_size + pos.y];
+    }
+
+    /**
+     * @brief 配置を置く/取り除く
+    */
+    inline void toggle(int const piece, int const pattern, Coord const pos){
+        value ^= key(piece, pattern, pos);
+    }
+
+    /**
+     * @brief 何も置いていない状態に戻す
+    */
+    void clear(){
+        value = 0;
+    }
+};
+
+} // namespace PolyominoPuzzle